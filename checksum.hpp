@@ -0,0 +1,222 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// NOTE: XXH64 (https://github.com/Cyan4973/xxHash), re-implemented here so
+// the tools keep building from single files without extra dependencies.
+namespace xxh64_detail {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t read64(const unsigned char *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t read32(const unsigned char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = std::rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val) {
+  acc ^= xxhRound(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+
+}  // namespace xxh64_detail
+
+inline uint64_t xxh64(const void *data, std::size_t len, uint64_t seed = 0) {
+  using namespace xxh64_detail;
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  const unsigned char *end = p + len;
+  uint64_t h{0};
+
+  if (len >= 32) {
+    uint64_t v1{seed + kPrime1 + kPrime2};
+    uint64_t v2{seed + kPrime2};
+    uint64_t v3{seed};
+    uint64_t v4{seed - kPrime1};
+    const unsigned char *limit = end - 32;
+    do {
+      v1 = xxhRound(v1, read64(p));
+      v2 = xxhRound(v2, read64(p + 8));
+      v3 = xxhRound(v3, read64(p + 16));
+      v4 = xxhRound(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+        std::rotl(v4, 18);
+    h = mergeRound(h, v1);
+    h = mergeRound(h, v2);
+    h = mergeRound(h, v3);
+    h = mergeRound(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+
+  h += static_cast<uint64_t>(len);
+  for (; p + 8 <= end; p += 8) {
+    h ^= xxhRound(0, read64(p));
+    h = std::rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+    h = std::rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= static_cast<uint64_t>(*p) * kPrime5;
+    h = std::rotl(h, 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+// NOTE: Sidecar written by ./verify next to a dataset as <path>.vtsum.
+// The tree hash is xxh64 over each chunkBytes slice of the file (leaves)
+// and xxh64 over the leaf array seeded with the file size (root), so the
+// leaves can be hashed in parallel and a mismatch points at the bad chunk.
+struct Sidecar {
+  std::string format{};
+  std::string elem{};
+  uint64_t size{0};
+  int64_t mtime{0};
+  uint64_t npts{0};
+  uint64_t dims{0};
+  uint64_t chunkBytes{0};
+  uint64_t root{0};
+  std::vector<uint64_t> leaves{};
+};
+
+constexpr std::string_view kSidecarMagic = "vtsum";
+constexpr uint32_t kSidecarVersion = 1;
+
+inline std::string sidecarPath(const std::string &path) {
+  return path + ".vtsum";
+}
+
+inline int64_t fileMtime(const std::string &path) {
+  return std::filesystem::last_write_time(path).time_since_epoch().count();
+}
+
+inline uint64_t treeRoot(const std::vector<uint64_t> &leaves,
+                         uint64_t fileSize) {
+  return xxh64(leaves.data(), leaves.size() * sizeof(uint64_t), fileSize);
+}
+
+inline void writeSidecar(const std::string &path, const Sidecar &sidecar) {
+  std::ofstream writer(sidecarPath(path));
+  if (!writer.is_open()) {
+    throw std::runtime_error(std::format(
+        "ERROR(writeSidecar): Failed Open File [{}]", sidecarPath(path)));
+  }
+  writer << kSidecarMagic << ' ' << kSidecarVersion << '\n';
+  writer << "format " << sidecar.format << '\n';
+  writer << "elem " << sidecar.elem << '\n';
+  writer << "size " << sidecar.size << '\n';
+  writer << "mtime " << sidecar.mtime << '\n';
+  writer << "npts " << sidecar.npts << '\n';
+  writer << "dims " << sidecar.dims << '\n';
+  writer << "chunk " << sidecar.chunkBytes << '\n';
+  writer << std::format("root {:016x}\n", sidecar.root);
+  for (uint64_t leaf : sidecar.leaves) {
+    writer << std::format("leaf {:016x}\n", leaf);
+  }
+}
+
+inline std::optional<Sidecar> readSidecar(const std::string &path) {
+  std::ifstream reader(sidecarPath(path));
+  if (!reader.is_open()) {
+    return std::nullopt;
+  }
+  std::string magic{};
+  uint32_t version{0};
+  reader >> magic >> version;
+  if (magic != kSidecarMagic || version != kSidecarVersion) {
+    throw std::runtime_error(std::format(
+        "ERROR(readSidecar): Unknown Sidecar [{}]", sidecarPath(path)));
+  }
+  Sidecar sidecar{};
+  std::string key{};
+  while (reader >> key) {
+    if (key == "format") {
+      reader >> sidecar.format;
+    } else if (key == "elem") {
+      reader >> sidecar.elem;
+    } else if (key == "size") {
+      reader >> sidecar.size;
+    } else if (key == "mtime") {
+      reader >> sidecar.mtime;
+    } else if (key == "npts") {
+      reader >> sidecar.npts;
+    } else if (key == "dims") {
+      reader >> sidecar.dims;
+    } else if (key == "chunk") {
+      reader >> sidecar.chunkBytes;
+    } else if (key == "root") {
+      reader >> std::hex >> sidecar.root >> std::dec;
+    } else if (key == "leaf") {
+      uint64_t leaf{0};
+      reader >> std::hex >> leaf >> std::dec;
+      sidecar.leaves.push_back(leaf);
+    } else {
+      std::string ignored{};
+      std::getline(reader, ignored);
+    }
+  }
+  return sidecar;
+}
+
+// NOTE: Cheap O(1) check used by the other tools before they read a dataset.
+// Without a sidecar nothing is checked; a size mismatch means truncated or
+// replaced data and throws; a changed mtime only warns, since the content
+// may still be fine (run ./verify again to refresh the sidecar). The warning
+// goes to log, tools printing machine-readable output on stdout pass stderr.
+inline void checkSidecar(const std::string &path,
+                         std::ostream &log = std::cout) {
+  std::optional<Sidecar> sidecar{readSidecar(path)};
+  if (!sidecar) {
+    return;
+  }
+  uint64_t size{std::filesystem::file_size(path)};
+  if (size != sidecar->size) {
+    throw std::runtime_error(std::format(
+        "ERROR(checkSidecar): [{}] has {} bytes but was verified with {} "
+        "bytes, file is truncated or corrupted",
+        path, size, sidecar->size));
+  }
+  if (fileMtime(path) != sidecar->mtime) {
+    log << std::format("WARNING: [{}] was modified after ./verify, "
+                       "checksum sidecar is stale",
+                       path)
+        << std::endl;
+  }
+}
@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "checksum.hpp"
+#include "denseFile.hpp"
+#include "formatTraits.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include "parseList.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// NOTE: base rows per chunk when --checkpoint is given without --block-rows
+constexpr uint64_t kDefaultBlockRows = 1UL << 20;
+// NOTE: base rows scored against a query block before moving on, sized so a
+// tile stays in L1/L2 while every query of the block reuses it
+constexpr uint64_t kBaseTileRows = 64;
+// NOTE: bytes of query vectors per work item (one thread's L2 share)
+constexpr uint64_t kQueryBlockBytes = 256UL << 10;
+
+enum class Metric : uint32_t { L2, IP };
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+// NOTE: smaller key is better: squared L2 distance, or minus inner product
+struct Candidate {
+  float key;
+  uint32_t id;
+};
+
+inline bool isBetter(const Candidate &a, const Candidate &b) {
+  return a.key < b.key || (a.key == b.key && a.id < b.id);
+}
+
+// NOTE: fixed capacity top-k per query, heap front is the worst candidate
+struct TopK {
+  std::vector<Candidate> heap{};
+
+  void push(uint32_t k, Candidate candidate) {
+    if (heap.size() < k) {
+      heap.push_back(candidate);
+      std::push_heap(heap.begin(), heap.end(), isBetter);
+    } else if (isBetter(candidate, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), isBetter);
+      heap.back() = candidate;
+      std::push_heap(heap.begin(), heap.end(), isBetter);
+    }
+  }
+};
+
+#if defined(__AVX2__) && defined(__FMA__)
+inline float horizontalSum(__m256 v) {
+  __m128 lo = _mm256_castps256_ps128(v);
+  __m128 hi = _mm256_extractf128_ps(v, 1);
+  lo = _mm_add_ps(lo, hi);
+  lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+  lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+  return _mm_cvtss_f32(lo);
+}
+#endif
+
+// NOTE: 4 queries x 2 base rows register-blocked micro kernel, out[i][j]
+// is the key of q[i] against b[j]
+template <Metric M>
+inline void keys4x2(const float *const q[4], const float *const b[2],
+                    uint32_t dims, float out[4][2]) {
+  uint32_t d{0};
+#if defined(__AVX2__) && defined(__FMA__)
+  __m256 acc[4][2];
+  for (auto &row : acc) {
+    row[0] = _mm256_setzero_ps();
+    row[1] = _mm256_setzero_ps();
+  }
+  for (; d + 8 <= dims; d += 8) {
+    __m256 b0 = _mm256_loadu_ps(b[0] + d);
+    __m256 b1 = _mm256_loadu_ps(b[1] + d);
+    for (int i{0}; i < 4; ++i) {
+      __m256 qv = _mm256_loadu_ps(q[i] + d);
+      if constexpr (M == Metric::L2) {
+        __m256 d0 = _mm256_sub_ps(qv, b0);
+        __m256 d1 = _mm256_sub_ps(qv, b1);
+        acc[i][0] = _mm256_fmadd_ps(d0, d0, acc[i][0]);
+        acc[i][1] = _mm256_fmadd_ps(d1, d1, acc[i][1]);
+      } else {
+        acc[i][0] = _mm256_fmadd_ps(qv, b0, acc[i][0]);
+        acc[i][1] = _mm256_fmadd_ps(qv, b1, acc[i][1]);
+      }
+    }
+  }
+  for (int i{0}; i < 4; ++i) {
+    out[i][0] = horizontalSum(acc[i][0]);
+    out[i][1] = horizontalSum(acc[i][1]);
+  }
+#else
+  for (int i{0}; i < 4; ++i) {
+    out[i][0] = 0;
+    out[i][1] = 0;
+  }
+#endif
+  for (int i{0}; i < 4; ++i) {
+    for (int j{0}; j < 2; ++j) {
+      float tail{0};
+      for (uint32_t t{d}; t < dims; ++t) {
+        if constexpr (M == Metric::L2) {
+          float diff{q[i][t] - b[j][t]};
+          tail += diff * diff;
+        } else {
+          tail += q[i][t] * b[j][t];
+        }
+      }
+      float sum{out[i][j] + tail};
+      out[i][j] = M == Metric::L2 ? sum : -sum;
+    }
+  }
+}
+
+// NOTE: Score queries [qBegin, qEnd) against every row of one base chunk,
+// walking the chunk in kBaseTileRows tiles. Ragged edges repeat the last
+// valid pointer and drop the extra results.
+template <Metric M>
+void scoreBlock(const std::vector<float> &queries, uint32_t dims,
+                uint64_t qBegin, uint64_t qEnd, const float *base,
+                uint64_t baseRows, uint64_t baseFirstId, uint32_t k,
+                std::vector<TopK> &topk) {
+  for (uint64_t tb{0}; tb < baseRows; tb += kBaseTileRows) {
+    uint64_t te{std::min(baseRows, tb + kBaseTileRows)};
+    for (uint64_t q0{qBegin}; q0 < qEnd; q0 += 4) {
+      const float *qp[4];
+      for (int i{0}; i < 4; ++i) {
+        qp[i] = queries.data() +
+                std::min<uint64_t>(q0 + i, qEnd - 1) * dims;
+      }
+      for (uint64_t b0{tb}; b0 < te; b0 += 2) {
+        const float *bp[2]{base + b0 * dims,
+                           base + std::min(b0 + 1, te - 1) * dims};
+        float keys[4][2];
+        keys4x2<M>(qp, bp, dims, keys);
+        for (uint64_t i{0}; i < 4 && q0 + i < qEnd; ++i) {
+          TopK &best = topk[q0 + i];
+          for (uint64_t j{0}; j < 2 && b0 + j < te; ++j) {
+            if (best.heap.size() == k && keys[i][j] > best.heap.front().key) {
+              continue;
+            }
+            best.push(k, {keys[i][j], static_cast<uint32_t>(baseFirstId + b0 +
+                                                            j)});
+          }
+        }
+      }
+    }
+  }
+}
+
+struct Checkpoint {
+  char magic[8];
+  uint32_t version;
+  Metric metric;
+  uint64_t nq;
+  uint64_t nb;
+  uint32_t dims;
+  uint32_t k;
+  uint64_t blockRows;
+  uint64_t baseSize;
+  int64_t baseMtime;
+  uint64_t querySize;
+  int64_t queryMtime;
+  uint64_t nextChunk;
+};
+
+constexpr char kCheckpointMagic[8] = {'V', 'T', 'G', 'T', 'C', 'K', 'P', 'T'};
+constexpr uint32_t kCheckpointVersion = 2;
+
+bool sameJob(const Checkpoint &a, const Checkpoint &b) {
+  return a.metric == b.metric && a.nq == b.nq && a.nb == b.nb &&
+         a.dims == b.dims && a.k == b.k && a.blockRows == b.blockRows &&
+         a.baseSize == b.baseSize && a.baseMtime == b.baseMtime &&
+         a.querySize == b.querySize && a.queryMtime == b.queryMtime;
+}
+
+// NOTE: written to <path>.tmp and renamed, so a crash while checkpointing
+// leaves the previous checkpoint intact
+void saveCheckpoint(const std::string &path, const Checkpoint &state,
+                    const std::vector<TopK> &topk) {
+  std::string tmpPath{path + ".tmp"};
+  {
+    std::ofstream writer(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!writer.is_open()) {
+      throw std::runtime_error("ERROR(saveCheckpoint): Failed Open File " +
+                               tmpPath);
+    }
+    writer.write(reinterpret_cast<const char *>(&state), sizeof(state));
+    for (const TopK &best : topk) {
+      uint32_t count = best.heap.size();
+      writer.write(reinterpret_cast<const char *>(&count), sizeof(count));
+      writer.write(reinterpret_cast<const char *>(best.heap.data()),
+                   count * sizeof(Candidate));
+    }
+    writer.flush();
+    if (!writer) {
+      throw std::runtime_error("ERROR(saveCheckpoint): Failed Write File " +
+                               tmpPath);
+    }
+  }
+  std::filesystem::rename(tmpPath, path);
+}
+
+std::optional<uint64_t> loadCheckpoint(const std::string &path,
+                                       const Checkpoint &expect,
+                                       std::vector<TopK> &topk) {
+  std::ifstream reader(path, std::ios::binary);
+  if (!reader.is_open()) {
+    return std::nullopt;
+  }
+  Checkpoint state{};
+  reader.read(reinterpret_cast<char *>(&state), sizeof(state));
+  if (!reader ||
+      std::memcmp(state.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) ||
+      state.version != kCheckpointVersion) {
+    throw std::runtime_error("ERROR(loadCheckpoint): Not A Checkpoint " + path);
+  }
+  if (!sameJob(state, expect)) {
+    throw std::runtime_error(std::format(
+        "ERROR(loadCheckpoint): [{}] belongs to a different job (inputs, K, "
+        "metric or block rows changed), remove it to start over",
+        path));
+  }
+  for (TopK &best : topk) {
+    uint32_t count{0};
+    reader.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!reader || count > state.k) {
+      throw std::runtime_error("ERROR(loadCheckpoint): Truncated " + path);
+    }
+    best.heap.resize(count);
+    reader.read(reinterpret_cast<char *>(best.heap.data()),
+                count * sizeof(Candidate));
+  }
+  if (!reader) {
+    throw std::runtime_error("ERROR(loadCheckpoint): Truncated " + path);
+  }
+  return state.nextChunk;
+}
+
+void writeGroundTruth(const std::string &path, Metric metric, uint32_t k,
+                      std::vector<TopK> &topk) {
+  const uint32_t nq = topk.size();
+  std::vector<uint32_t> ids(uint64_t{nq} * k);
+  std::vector<float> dists(uint64_t{nq} * k);
+  for (uint64_t q{0}; q < nq; ++q) {
+    std::vector<Candidate> &heap = topk[q].heap;
+    std::sort(heap.begin(), heap.end(), isBetter);
+    for (uint32_t i{0}; i < k; ++i) {
+      ids[q * k + i] = heap[i].id;
+      dists[q * k + i] = metric == Metric::L2 ? heap[i].key : -heap[i].key;
+    }
+  }
+  std::ofstream writer(path, std::ios::binary);
+  if (!writer.is_open()) {
+    throw std::runtime_error("ERROR(writeGroundTruth): Failed Open File " +
+                             path);
+  }
+  writer.write(reinterpret_cast<const char *>(&nq), sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(&k), sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(ids.data()),
+               ids.size() * sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(dists.data()),
+               dists.size() * sizeof(float));
+}
+
+struct GTJob {
+  DenseFile base;
+  DenseFile query;
+  std::string gtPath;
+  uint32_t k;
+  Metric metric;
+  uint64_t blockRows;
+  std::string checkpointPath;
+  unsigned threads;
+};
+
+// NOTE: Exact brute-force top-K. The base is streamed in blockRows chunks
+// (the next chunk is read in the background while the current one is
+// scored), every query keeps a running top-K merged across chunks, and with
+// a checkpoint path the heaps are persisted after each chunk so a restarted
+// job continues at the first unfinished chunk. Without --block-rows the whole
+// base is a single chunk, i.e. the in-memory path.
+template <Metric M> void computeGT(const GTJob &job) {
+  const DenseFile &base = job.base;
+  const uint64_t nq{job.query.npts};
+  const uint32_t dims{base.dims};
+  const uint32_t k{static_cast<uint32_t>(std::min<uint64_t>(job.k, base.npts))};
+  const uint64_t blockRows{std::max<uint64_t>(1, job.blockRows)};
+  const uint64_t numChunks{(base.npts + blockRows - 1) / blockRows};
+
+  std::vector<float> queries{loadRows(job.query, 0, nq)};
+  std::vector<TopK> topk(nq);
+
+  Checkpoint state{};
+  std::memcpy(state.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+  state.version = kCheckpointVersion;
+  state.metric = M;
+  state.nq = nq;
+  state.nb = base.npts;
+  state.dims = dims;
+  state.k = k;
+  state.blockRows = blockRows;
+  state.baseSize = base.size;
+  state.baseMtime = fileMtime(base.path);
+  state.querySize = job.query.size;
+  state.queryMtime = fileMtime(job.query.path);
+
+  uint64_t firstChunk{0};
+  if (!job.checkpointPath.empty()) {
+    if (std::optional<uint64_t> next{
+            loadCheckpoint(job.checkpointPath, state, topk)}) {
+      firstChunk = *next;
+      std::cout << std::format("Resume From Checkpoint {}: chunk {} of {}",
+                               job.checkpointPath, firstChunk, numChunks)
+                << std::endl;
+    }
+  }
+
+  const uint64_t queryBlock{std::max<uint64_t>(
+      4, kQueryBlockBytes / (uint64_t{dims} * sizeof(float)) / 4 * 4)};
+  auto loadChunk = [&](uint64_t c) {
+    return loadRows(base, c * blockRows,
+                    std::min(base.npts, (c + 1) * blockRows));
+  };
+
+  std::future<std::vector<float>> pending{};
+  if (firstChunk < numChunks) {
+    pending = std::async(std::launch::async, loadChunk, firstChunk);
+  }
+  for (uint64_t c{firstChunk}; c < numChunks; ++c) {
+    std::vector<float> chunk{pending.get()};
+    if (c + 1 < numChunks) {
+      pending = std::async(std::launch::async, loadChunk, c + 1);
+    }
+    const uint64_t first{c * blockRows};
+    const uint64_t rows{chunk.size() / std::max<uint32_t>(1, dims)};
+    parallelFor(
+        0, nq, queryBlock,
+        [&](uint64_t begin, uint64_t end, unsigned) {
+          scoreBlock<M>(queries, dims, begin, end, chunk.data(), rows, first,
+                        k, topk);
+        },
+        job.threads);
+
+    if (!job.checkpointPath.empty()) {
+      state.nextChunk = c + 1;
+      saveCheckpoint(job.checkpointPath, state, topk);
+    }
+    std::cout << std::format("Processed chunk {} of {}, base rows [{}, {})",
+                             c + 1, numChunks, first, first + rows)
+              << std::endl;
+  }
+
+  writeGroundTruth(job.gtPath, M, k, topk);
+  if (!job.checkpointPath.empty()) {
+    std::filesystem::remove(job.checkpointPath);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 8 || argc % 2 == 1) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./compute_gt [base path] [base format] [query path] "
+                 "[query format] [gt output path] [K] [l2|ip] "
+                 "[--block-rows N] [--checkpoint path] [--type data type] "
+                 "[--threads N]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string basePath{argv[1]};
+  std::string baseFormatName{argv[2]};
+  std::string queryPath{argv[3]};
+  std::string queryFormatName{argv[4]};
+  std::string gtPath{argv[5]};
+  std::string metricName{argv[7]};
+  std::string dataType{"f32"};
+  std::string checkpointPath{};
+  uint64_t blockRows{0};
+  uint32_t k{0};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(basePath);
+    checkFileExists(queryPath);
+    checkSidecar(basePath);
+    checkSidecar(queryPath);
+    k = parseUnsigned(argv[6], std::numeric_limits<uint32_t>::max());
+    if (k == 0) {
+      throw std::runtime_error("K must be positive");
+    }
+    for (int i{8}; i + 1 < argc; i += 2) {
+      std::string option{argv[i]};
+      if (option == "--block-rows") {
+        blockRows = std::stoull(argv[i + 1]);
+      } else if (option == "--checkpoint") {
+        checkpointPath = argv[i + 1];
+      } else if (option == "--type") {
+        dataType = argv[i + 1];
+      } else if (option == "--threads") {
+        threads = std::max(1, std::stoi(argv[i + 1]));
+      } else {
+        throw std::runtime_error("Unknown Option: " + option);
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [K], [--block-rows] and [--threads] must be integers."
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::optional<Format> baseFormat{parseFormat(baseFormatName)};
+  std::optional<Format> queryFormat{parseFormat(queryFormatName)};
+  std::optional<ElemType> elem{parseElemType(dataType)};
+  if (!baseFormat || !queryFormat || !elem ||
+      (metricName != "l2" && metricName != "ip")) {
+    std::cerr << "ERROR: Input format, data type or metric does not meet "
+                 "requirements"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  try {
+    GTJob job{
+        inspectDenseFile(basePath, *baseFormat,
+                         baseFormat->elem.value_or(*elem)),
+        inspectDenseFile(queryPath, *queryFormat,
+                         queryFormat->elem.value_or(*elem)),
+        gtPath,
+        k,
+        metricName == "l2" ? Metric::L2 : Metric::IP,
+        blockRows,
+        checkpointPath,
+        threads};
+    if (job.base.dims != job.query.dims) {
+      throw std::runtime_error(
+          std::format("Base dims[{}] differs from query dims[{}]",
+                      job.base.dims, job.query.dims));
+    }
+    if (job.base.npts == 0) {
+      throw std::runtime_error("Base is empty, no neighbors to search");
+    }
+    if (job.base.npts > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("GT ids are uint32, base has too many rows");
+    }
+    if (job.blockRows == 0) {
+      job.blockRows =
+          job.checkpointPath.empty() ? job.base.npts : kDefaultBlockRows;
+    }
+    std::cout << std::format(
+                     "Base: npts[{}], dims[{}], {}; Query: npts[{}]; K[{}], "
+                     "metric[{}], block rows[{}]",
+                     job.base.npts, job.base.dims, elemName(job.base.elem),
+                     job.query.npts, job.k, metricName, job.blockRows)
+              << std::endl;
+    if (job.metric == Metric::L2) {
+      computeGT<Metric::L2>(job);
+    } else {
+      computeGT<Metric::IP>(job);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Ground Truth Done!" << std::endl;
+}
@@ -1,5 +1,6 @@
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <filesystem>
@@ -8,10 +9,15 @@
 #include <iostream>
 #include <memory>
 #include <numeric>
-#include <set>
 #include <string>
 #include <vector>
 
+#include "checksum.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include "parseList.hpp"
+#include "recall.hpp"
+
 void checkFileExists(const std::string &path) {
   if (!std::filesystem::exists(path)) {
     throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
@@ -85,92 +91,218 @@ std::unique_ptr<char[]> readVec(const std::string &path, const unsigned size) {
   return data;
 }
 
-double calculateSingleRecall(uint32_t *gtIDs, float *gtDists, uint32_t gtDims,
-                             uint32_t *resIDs, uint32_t resDims,
-                             uint32_t topK) {
-  std::set<uint32_t> gt, res;
-
-  //  NOTE: Include all ground truth neighbors tied at the topK distance.
-  uint32_t gtTieBreaker = topK;
-  if (gtDists != nullptr) {
-    gtTieBreaker = topK - 1;
-    while (gtTieBreaker < gtDims &&
-           gtDists[gtTieBreaker] == gtDists[topK - 1]) {
-      ++gtTieBreaker;
-    }
-  }
+struct BatchRecall {
+  std::string path{};
+  std::string error{};
+  uint32_t queries{0};
+  // NOTE: one entry per requested k, NaN when k exceeds the file's dims
+  std::vector<double> mean{};
+  std::vector<double> stddev{};
+};
 
-  gt.insert(gtIDs, gtIDs + gtTieBreaker);
-  res.insert(resIDs, resIDs + topK);
+// NOTE: The GT is mapped once and shared; result files are scored
+// concurrently, one file per work item. A broken result file only fails its
+// own row.
+std::vector<BatchRecall> computeBatchRecall(
+    const ResultView &gt, const std::vector<std::string> &resultPaths,
+    const std::vector<uint32_t> &ks, unsigned threads, std::ostream &log) {
+  std::vector<BatchRecall> batch(resultPaths.size());
+  parallelFor(
+      0, resultPaths.size(), 1,
+      [&](uint64_t begin, uint64_t end, unsigned) {
+        for (uint64_t i{begin}; i < end; ++i) {
+          BatchRecall &entry = batch[i];
+          entry.path = resultPaths[i];
+          try {
+            checkSidecar(entry.path, log);
+            ResultView res{mapResultBin(entry.path)};
+            if (res.npts != gt.npts) {
+              throw std::runtime_error(
+                  std::format("{} queries, GT has {}", res.npts, gt.npts));
+            }
+            entry.queries = res.npts;
+            for (uint32_t k : ks) {
+              if (k > res.dims || k > gt.dims) {
+                entry.mean.push_back(std::nan(""));
+                entry.stddev.push_back(std::nan(""));
+                continue;
+              }
+              const std::vector<double> recallLists = calculateRecallPerQuery(
+                  res.npts, gt.ids, gt.dists, gt.dims, res.ids, res.dims, k);
+              entry.mean.push_back(computeRecallAvg(recallLists));
+              entry.stddev.push_back(computeRecallSTD(recallLists));
+            }
+          } catch (const std::exception &e) {
+            entry.error = e.what();
+          }
+        }
+      },
+      threads);
+  return batch;
+}
 
-  unsigned curRecall = 0;
-  for (auto id : res) {
-    if (gt.find(id) != gt.end()) {
-      ++curRecall;
+std::string jsonEscape(const std::string &text) {
+  std::string escaped{};
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      escaped += std::format("\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      escaped += c;
     }
   }
+  return escaped;
+}
 
-  return static_cast<double>(curRecall) / topK;
+std::string jsonNumber(double value) {
+  return std::isnan(value) ? "null" : std::format("{:.6f}", value);
 }
 
-double calculateTotalRecall(uint32_t numQueries, uint32_t *gtIDs,
-                            float *gtDists, uint32_t gtDims, uint32_t *resIDs,
-                            uint32_t resDims, uint32_t topK) {
-  double totalRecall = 0;
-  for (unsigned q{0}; q < numQueries; ++q) {
-    std::set<uint32_t> gt, res;
-    uint32_t *gtVec = gtIDs + q * gtDims;
-    uint32_t *resVec = resIDs + q * resDims;
-    float *gtDistVec = gtDists == nullptr ? nullptr : gtDists + q * gtDims;
-
-    totalRecall +=
-        calculateSingleRecall(gtVec, gtDistVec, gtDims, resVec, resDims, topK);
+void printBatchTable(const std::vector<BatchRecall> &batch,
+                     const std::vector<uint32_t> &ks) {
+  std::cout << std::format("{:<48} {:>8} {:>6} {:>10} {:>10}", "file",
+                           "queries", "k", "mean", "std")
+            << std::endl;
+  for (const BatchRecall &entry : batch) {
+    if (!entry.error.empty()) {
+      std::cout << std::format("{:<48} ERROR: {}", entry.path, entry.error)
+                << std::endl;
+      continue;
+    }
+    for (std::size_t i{0}; i < ks.size(); ++i) {
+      if (std::isnan(entry.mean[i])) {
+        continue;
+      }
+      std::cout << std::format("{:<48} {:>8} {:>6} {:>10.6f} {:>10.6f}",
+                               entry.path, entry.queries, ks[i], entry.mean[i],
+                               entry.stddev[i])
+                << std::endl;
+    }
   }
-  return totalRecall / numQueries;
 }
 
-std::vector<double> calculateRecallPerQuery(uint32_t numQueries,
-                                            uint32_t *gtIDs, float *gtDists,
-                                            uint32_t gtDims, uint32_t *resIDs,
-                                            uint32_t resDims, uint32_t topK) {
-  std::vector<double> recallList(numQueries);
-  for (unsigned q{0}; q < numQueries; ++q) {
-    uint32_t *gtVec = gtIDs + q * gtDims;
-    uint32_t *resVec = resIDs + q * resDims;
-    float *gtDistVec = gtDists == nullptr ? nullptr : gtDists + q * gtDims;
-
-    recallList.at(q) =
-        calculateSingleRecall(gtVec, gtDistVec, gtDims, resVec, resDims, topK);
+void writeBatchJson(std::ostream &out, const std::vector<BatchRecall> &batch,
+                    const std::vector<uint32_t> &ks) {
+  out << "[\n";
+  for (std::size_t f{0}; f < batch.size(); ++f) {
+    const BatchRecall &entry = batch[f];
+    out << std::format("  {{\"file\": \"{}\", ", jsonEscape(entry.path));
+    if (!entry.error.empty()) {
+      out << std::format("\"error\": \"{}\"}}", jsonEscape(entry.error));
+    } else {
+      out << std::format("\"queries\": {}, \"recall\": {{", entry.queries);
+      for (std::size_t i{0}; i < ks.size(); ++i) {
+        out << std::format("{}\"{}\": {{\"mean\": {}, \"std\": {}}}",
+                           i == 0 ? "" : ", ", ks[i], jsonNumber(entry.mean[i]),
+                           jsonNumber(entry.stddev[i]));
+      }
+      out << "}}";
+    }
+    out << (f + 1 == batch.size() ? "\n" : ",\n");
   }
-  return recallList;
+  out << "]" << std::endl;
 }
 
-double computeRecallSTD(const std::vector<double> &recallLists) {
-  unsigned numQueries = recallLists.size();
-  double mean =
-      std::accumulate(recallLists.begin(), recallLists.end(), 0.0) / numQueries;
-  double varience = 0;
-  for (auto recall : recallLists) {
-    varience += std::pow((recall - mean), 2);
+int runBatch(int argc, char **argv) {
+  if (argc < 5) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./compute_recall_std --batch [gt file path] "
+                 "[gt format] [result file paths...] [--k 1,10,100] "
+                 "[--json output path or -] [--threads N]"
+              << std::endl;
+    return EXIT_FAILURE;
   }
-  varience /= numQueries;
-  return std::sqrt(varience);
-}
 
-double computeRecallAvg(const std::vector<double> &recallLists) {
-  if (recallLists.empty()) {
-    return 0;
+  std::string gtPath{argv[2]};
+  std::string gtFormat{argv[3]};
+  std::vector<std::string> resultPaths{};
+  std::vector<uint32_t> ks{1, 10, 100};
+  std::string jsonPath{};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    for (int i{4}; i < argc; ++i) {
+      std::string arg{argv[i]};
+      if (arg == "--k" && i + 1 < argc) {
+        ks = parseKList(argv[++i]);
+      } else if (arg == "--json" && i + 1 < argc) {
+        jsonPath = argv[++i];
+      } else if (arg == "--threads" && i + 1 < argc) {
+        threads = std::stoul(argv[++i]);
+      } else {
+        resultPaths.push_back(arg);
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [--k] and [--threads] must be integers." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (gtFormat != "bin") {
+    std::cerr << "ERROR: --batch just support [bin] format now!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // NOTE: with --json - stdout carries only the JSON array
+  std::ostream &log{jsonPath == "-" ? std::cerr : std::cout};
+
+  try {
+    checkFileExists(gtPath);
+    checkSidecar(gtPath, log);
+    ResultView gt{mapResultBin(gtPath)};
+    gt.file.adviseWillNeed();
+    log << std::format("Read GroundTruth From {}: Npts: {}, Dims: {}{}, "
+                       "{} result files",
+                       gtPath, gt.npts, gt.dims,
+                       gt.dists != nullptr ? " (ties by distance)" : "",
+                       resultPaths.size())
+        << std::endl;
+
+    std::vector<BatchRecall> batch{
+        computeBatchRecall(gt, resultPaths, ks, threads, log)};
+    if (jsonPath == "-") {
+      writeBatchJson(std::cout, batch, ks);
+    } else {
+      printBatchTable(batch, ks);
+      if (!jsonPath.empty()) {
+        std::ofstream writer(jsonPath);
+        if (!writer.is_open()) {
+          throw std::runtime_error("ERROR(runBatch): Failed Open File " +
+                                   jsonPath);
+        }
+        writeBatchJson(writer, batch, ks);
+      }
+    }
+    // NOTE: every row is still reported, but a broken result file must not
+    // look like a clean run to a calling script
+    for (const BatchRecall &entry : batch) {
+      if (!entry.error.empty()) {
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
   }
-  double sum = std::accumulate(recallLists.begin(), recallLists.end(), 0.0);
-  return sum / recallLists.size();
+  return EXIT_SUCCESS;
 }
 
 int main(int argc, char **argv) {
+  if (argc >= 2 && std::string(argv[1]) == "--batch") {
+    return runBatch(argc, argv);
+  }
   if (argc != 5) {
     std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
     std::cout << "Usage: ./compute_recall_std "
                  "[result file path] [result format] [gt file path] [gt format]"
               << std::endl;
+    std::cout << "       ./compute_recall_std --batch [gt file path] "
+                 "[gt format] [result file paths...] [--k 1,10,100] "
+                 "[--json output path or -] [--threads N]"
+              << std::endl;
     exit(EXIT_FAILURE);
   }
 
@@ -182,6 +314,8 @@ int main(int argc, char **argv) {
   try {
     checkFileExists(resultPath);
     checkFileExists(gtPath);
+    checkSidecar(resultPath);
+    checkSidecar(gtPath);
   } catch (const std::runtime_error &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     exit(EXIT_FAILURE);
@@ -193,13 +327,23 @@ int main(int argc, char **argv) {
 
   try {
     if (resultFormat == "bin" && gtFormat == "bin") {
-      unsigned resQueries, gtQueries, resDims, gtDims;
-      std::unique_ptr<uint32_t[]> resIDs =
-          loadResultBin(resultPath, resQueries, resDims, nullptr);
-      std::unique_ptr<uint32_t[]> gtIDs =
-          loadResultBin(gtPath, gtQueries, gtDims, nullptr);
+      // NOTE: same mapping and tie handling (GT neighbors tied at the k-th
+      // distance count as hits) as --batch and ./vtdaemon recall
+      constexpr uint32_t topK = 100;
+      ResultView res{mapResultBin(resultPath)};
+      ResultView gt{mapResultBin(gtPath)};
+      std::cout << std::format("Result Npts: {}, Dims: {}; GT Npts: {}, "
+                               "Dims: {}{}",
+                               res.npts, res.dims, gt.npts, gt.dims,
+                               gt.dists != nullptr ? " (ties by distance)" : "")
+                << std::endl;
+      if (res.npts != gt.npts || res.dims < topK || gt.dims < topK) {
+        throw std::runtime_error(std::format(
+            "ERROR: recall@{} needs equal npts and at least {} ids per query",
+            topK, topK));
+      }
       const std::vector<double> recallLists = calculateRecallPerQuery(
-          resQueries, gtIDs.get(), nullptr, gtDims, resIDs.get(), resDims, 100);
+          res.npts, gt.ids, gt.dists, gt.dims, res.ids, res.dims, topK);
       double recallAvg = computeRecallAvg(recallLists);
       double stdRecall = computeRecallSTD(recallLists);
 
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "parallel.hpp"
+#include "parseList.hpp"
+#include "sparseFile.hpp"
+
+// NOTE: base rows indexed per inverted-index block, bounds memory to
+// O(nnz of one block) and keeps each thread's score accumulator small
+constexpr uint64_t kBaseBlockRows = 1UL << 20;
+constexpr uint64_t kGrainQueries = 16;
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+struct Candidate {
+  float score;
+  uint32_t id;
+};
+
+// NOTE: higher inner product first, smaller id breaks ties
+inline bool isBetter(const Candidate &a, const Candidate &b) {
+  return a.score > b.score || (a.score == b.score && a.id < b.id);
+}
+
+// NOTE: top-k kept as a heap whose front is the worst candidate
+inline void pushCandidate(std::vector<Candidate> &heap, uint32_t k,
+                          Candidate candidate) {
+  if (heap.size() < k) {
+    heap.push_back(candidate);
+    std::push_heap(heap.begin(), heap.end(), isBetter);
+  } else if (isBetter(candidate, heap.front())) {
+    std::pop_heap(heap.begin(), heap.end(), isBetter);
+    heap.back() = candidate;
+    std::push_heap(heap.begin(), heap.end(), isBetter);
+  }
+}
+
+// NOTE: column -> (local row, value) postings of base rows [first, last)
+struct InvertedBlock {
+  std::vector<uint64_t> colPtr{};
+  std::vector<uint32_t> rows{};
+  std::vector<float> values{};
+};
+
+InvertedBlock buildInvertedBlock(const SparseMatrix &base, uint64_t first,
+                                 uint64_t last) {
+  const uint64_t ncol{base.ncol()};
+  InvertedBlock block;
+  block.colPtr.assign(ncol + 1, 0);
+  for (uint64_t i{first}; i < last; ++i) {
+    SparseRow row{base.row(i)};
+    for (uint64_t k{0}; k < row.nnz; ++k) {
+      int32_t j{row.indices[k]};
+      if (j >= 0 && static_cast<uint64_t>(j) < ncol) {
+        ++block.colPtr[j + 1];
+      }
+    }
+  }
+  for (uint64_t j{0}; j < ncol; ++j) {
+    block.colPtr[j + 1] += block.colPtr[j];
+  }
+  block.rows.resize(block.colPtr[ncol]);
+  block.values.resize(block.colPtr[ncol]);
+  std::vector<uint64_t> cursor(block.colPtr.begin(), block.colPtr.end() - 1);
+  for (uint64_t i{first}; i < last; ++i) {
+    SparseRow row{base.row(i)};
+    for (uint64_t k{0}; k < row.nnz; ++k) {
+      int32_t j{row.indices[k]};
+      if (j >= 0 && static_cast<uint64_t>(j) < ncol) {
+        uint64_t pos{cursor[j]++};
+        block.rows[pos] = static_cast<uint32_t>(i - first);
+        block.values[pos] = row.values[k];
+      }
+    }
+  }
+  return block;
+}
+
+// NOTE: The heap holds the exact top-k among rows sharing a column with the
+// query; every other row scores exactly 0. Those rows (smallest ids first,
+// matching the tie-break) are merged in by score whenever they can matter:
+// the list is short, or its worst score is <= 0. Returns how many made it
+// into the final, sorted top-k.
+uint64_t mergeZeroScoreRows(const SparseMatrix &base, const SparseRow &qrow,
+                            uint32_t k, std::vector<Candidate> &heap,
+                            std::vector<uint8_t> &queryCols) {
+  std::sort(heap.begin(), heap.end(), isBetter);
+  if (heap.size() == k && heap.back().score > 0) {
+    return 0;
+  }
+  const uint64_t ncol{base.ncol()};
+  queryCols.resize(ncol);
+  for (uint64_t t{0}; t < qrow.nnz; ++t) {
+    int32_t j{qrow.indices[t]};
+    if (j >= 0 && static_cast<uint64_t>(j) < ncol) {
+      queryCols[j] = 1;
+    }
+  }
+  std::vector<Candidate> zeros{};
+  for (uint64_t id{0}; id < base.nrow() && zeros.size() < k; ++id) {
+    SparseRow row{base.row(id)};
+    bool shares{false};
+    for (uint64_t t{0}; t < row.nnz && !shares; ++t) {
+      int32_t j{row.indices[t]};
+      shares = j >= 0 && static_cast<uint64_t>(j) < ncol && queryCols[j];
+    }
+    if (!shares) {
+      zeros.push_back({0.0f, static_cast<uint32_t>(id)});
+    }
+  }
+  for (uint64_t t{0}; t < qrow.nnz; ++t) {
+    int32_t j{qrow.indices[t]};
+    if (j >= 0 && static_cast<uint64_t>(j) < ncol) {
+      queryCols[j] = 0;
+    }
+  }
+
+  std::vector<Candidate> merged(heap.size() + zeros.size());
+  std::merge(heap.begin(), heap.end(), zeros.begin(), zeros.end(),
+             merged.begin(), isBetter);
+  merged.resize(std::min<std::size_t>(merged.size(), k));
+  uint64_t used = std::count_if(merged.begin(), merged.end(),
+                                [&](const Candidate &c) {
+                                  return c.score == 0 &&
+                                         std::binary_search(
+                                             zeros.begin(), zeros.end(), c,
+                                             isBetter);
+                                });
+  heap = std::move(merged);
+  return used;
+}
+
+// NOTE: Exact inner-product top-k. Each base block is turned into an
+// inverted index, then every query accumulates scores over the postings of
+// its own non-zeros into a per-thread dense accumulator (term-at-a-time),
+// and only touched rows go through the top-k heap. Rows sharing no column
+// with the query score exactly 0 and are merged in afterwards (see
+// mergeZeroScoreRows), so the result stays exact with negative values.
+void computeSparseGT(const std::string &basePath, const std::string &queryPath,
+                     const std::string &gtPath, uint32_t k, unsigned threads) {
+  SparseMatrix base(basePath);
+  SparseMatrix query(queryPath);
+  const uint64_t nb{base.nrow()}, nq{query.nrow()};
+  std::cout << std::format("Base: nrow[{}], ncol[{}], nnz[{}]", nb,
+                           base.ncol(), base.nnz())
+            << std::endl;
+  std::cout << std::format("Query: nrow[{}], ncol[{}], nnz[{}]", nq,
+                           query.ncol(), query.nnz())
+            << std::endl;
+  if (query.ncol() != base.ncol()) {
+    std::cout << "WARNING: query ncol differs from base ncol, columns "
+                 "outside the base are ignored"
+              << std::endl;
+  }
+  if (nb == 0) {
+    throw std::runtime_error("Base is empty, no neighbors to search");
+  }
+  if (nb > UINT32_MAX || nq > UINT32_MAX) {
+    throw std::runtime_error("GT ids are uint32, too many base/query rows");
+  }
+  k = static_cast<uint32_t>(std::min<uint64_t>(k, nb));
+
+  std::vector<std::vector<Candidate>> heaps(nq);
+  const uint64_t accRows{std::min(kBaseBlockRows, nb)};
+  std::vector<std::vector<float>> acc(threads, std::vector<float>(accRows));
+  std::vector<std::vector<uint8_t>> seen(threads,
+                                         std::vector<uint8_t>(accRows));
+  std::vector<std::vector<uint32_t>> touched(threads);
+
+  for (uint64_t first{0}; first < nb; first += kBaseBlockRows) {
+    uint64_t last{std::min(nb, first + kBaseBlockRows)};
+    InvertedBlock block{buildInvertedBlock(base, first, last)};
+    parallelFor(
+        0, nq, kGrainQueries,
+        [&](uint64_t begin, uint64_t end, unsigned tid) {
+          std::vector<float> &scores = acc[tid];
+          std::vector<uint8_t> &mark = seen[tid];
+          std::vector<uint32_t> &rows = touched[tid];
+          for (uint64_t q{begin}; q < end; ++q) {
+            SparseRow qrow{query.row(q)};
+            for (uint64_t t{0}; t < qrow.nnz; ++t) {
+              int32_t j{qrow.indices[t]};
+              if (j < 0 || static_cast<uint64_t>(j) >= base.ncol()) {
+                continue;
+              }
+              float qv{qrow.values[t]};
+              for (uint64_t p{block.colPtr[j]}; p < block.colPtr[j + 1]; ++p) {
+                uint32_t r{block.rows[p]};
+                if (!mark[r]) {
+                  mark[r] = 1;
+                  rows.push_back(r);
+                }
+                scores[r] += qv * block.values[p];
+              }
+            }
+            for (uint32_t r : rows) {
+              pushCandidate(heaps[q], k,
+                            {scores[r], static_cast<uint32_t>(first + r)});
+              scores[r] = 0;
+              mark[r] = 0;
+            }
+            rows.clear();
+          }
+        },
+        threads);
+    std::cout << std::format("Processed base rows [{}, {})", first, last)
+              << std::endl;
+  }
+
+  std::atomic<uint64_t> zeroRows{0};
+  std::vector<std::vector<uint8_t>> queryCols(threads);
+  parallelFor(
+      0, nq, kGrainQueries,
+      [&](uint64_t begin, uint64_t end, unsigned tid) {
+        for (uint64_t q{begin}; q < end; ++q) {
+          zeroRows += mergeZeroScoreRows(base, query.row(q), k, heaps[q],
+                                         queryCols[tid]);
+        }
+      },
+      threads);
+
+  std::vector<uint32_t> ids(nq * k);
+  std::vector<float> dists(nq * k);
+  for (uint64_t q{0}; q < nq; ++q) {
+    for (uint32_t i{0}; i < k; ++i) {
+      ids[q * k + i] = heaps[q][i].id;
+      dists[q * k + i] = heaps[q][i].score;
+    }
+  }
+  if (zeroRows > 0) {
+    std::cout << std::format(
+                     "NOTE: {} results are rows sharing no column with their "
+                     "query (score 0)",
+                     zeroRows.load())
+              << std::endl;
+  }
+
+  std::ofstream writer(gtPath, std::ios::binary);
+  if (!writer.is_open()) {
+    throw std::runtime_error("ERROR(computeSparseGT): Failed Open File " +
+                             gtPath);
+  }
+  uint32_t npts{static_cast<uint32_t>(nq)};
+  writer.write(reinterpret_cast<const char *>(&npts), sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(&k), sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(ids.data()),
+               ids.size() * sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(dists.data()),
+               dists.size() * sizeof(float));
+}
+
+int main(int argc, char **argv) {
+  if (argc != 5 && argc != 6) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./compute_sparse_gt [base csr path] [query csr path] "
+                 "[gt output path] [K] [threads(optional)]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string basePath{argv[1]};
+  std::string queryPath{argv[2]};
+  std::string gtPath{argv[3]};
+  uint32_t k{0};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(basePath);
+    checkFileExists(queryPath);
+    checkSidecar(basePath);
+    checkSidecar(queryPath);
+    k = parseUnsigned(argv[4], UINT32_MAX);
+    if (k == 0) {
+      throw std::runtime_error("K must be positive");
+    }
+    if (argc == 6) {
+      threads = std::max(1, std::stoi(argv[5]));
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [K] and [threads] Argument must be an integer."
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  try {
+    computeSparseGT(basePath, queryPath, gtPath, k, threads);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Sparse Ground Truth Done!" << std::endl;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// NOTE: Wire protocol between ./vtdaemon and ./vtclient, one request per
+// connection over a Unix domain stream socket:
+//   request:  every argument followed by '\n', then an empty line
+//   response: "OK\n" or "ERROR: <message>\n", then the body, then EOF
+// Arguments are plain tokens, so paths cannot contain a newline.
+constexpr std::size_t kMaxRequestBytes = 64UL << 10;
+
+inline sockaddr_un makeSocketAddress(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error(std::format(
+        "ERROR(makeSocketAddress): Socket path must be 1..{} bytes [{}]",
+        sizeof(addr.sun_path) - 1, path));
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size());
+  return addr;
+}
+
+inline void sendAll(int fd, const std::string &data) {
+  const char *buf = data.data();
+  std::size_t len{data.size()};
+  while (len > 0) {
+    ssize_t sent = ::send(fd, buf, len, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      throw std::runtime_error("ERROR(sendAll): Failed Write Socket");
+    }
+    buf += sent;
+    len -= sent;
+  }
+}
+
+inline std::string encodeRequest(const std::vector<std::string> &args) {
+  std::string request{};
+  for (const std::string &arg : args) {
+    if (arg.empty() || arg.find('\n') != std::string::npos) {
+      throw std::runtime_error(
+          "ERROR(encodeRequest): Arguments must be non-empty single lines");
+    }
+    request += arg;
+    request += '\n';
+  }
+  request += '\n';
+  return request;
+}
+
+// NOTE: reads up to the empty line closing a request, throws on EOF first
+inline std::vector<std::string> readRequest(int fd) {
+  std::string buffer{};
+  char chunk[4096];
+  while (buffer.find("\n\n") == std::string::npos) {
+    ssize_t got = ::recv(fd, chunk, sizeof(chunk), 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      throw std::runtime_error("ERROR(readRequest): Incomplete Request");
+    }
+    buffer.append(chunk, got);
+    if (buffer.size() > kMaxRequestBytes) {
+      throw std::runtime_error("ERROR(readRequest): Request Too Large");
+    }
+  }
+  std::vector<std::string> args{};
+  std::size_t pos{0};
+  for (std::size_t end{buffer.find('\n')}; end != pos;
+       end = buffer.find('\n', pos)) {
+    args.push_back(buffer.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  return args;
+}
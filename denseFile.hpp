@@ -0,0 +1,125 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "formatTraits.hpp"
+
+// NOTE: Geometry of a dense bin/vecs file, enough to pread any row range
+// without mapping or loading the whole file.
+struct DenseFile {
+  std::string path{};
+  Container container{Container::Bin};
+  ElemType elem{ElemType::F32};
+  uint64_t npts{0};
+  uint32_t dims{0};
+  uint64_t headerBytes{0};
+  uint64_t rowBytes{0};
+  uint64_t size{0};
+};
+
+inline DenseFile inspectDenseFile(const std::string &path,
+                                  const Format &format, ElemType elem) {
+  DenseFile file{path, format.container, elem};
+  file.size = std::filesystem::file_size(path);
+  file.headerBytes = fileHeaderBytes(format.container);
+  std::fstream reader(path, std::ios::in | std::ios::binary);
+  if (!reader.is_open() || file.size < file.headerBytes + sizeof(uint32_t)) {
+    throw std::runtime_error("ERROR(inspectDenseFile): Bad File " + path);
+  }
+  if (format.container == Container::Bin) {
+    uint32_t header[2];
+    reader.read(reinterpret_cast<char *>(header), sizeof(header));
+    file.npts = header[0];
+    file.dims = header[1];
+    file.rowBytes = file.dims * elemSize(elem);
+  } else {
+    reader.read(reinterpret_cast<char *>(&file.dims), sizeof(uint32_t));
+    file.rowBytes = rowPrefixBytes(format.container) +
+                    file.dims * elemSize(elem);
+    file.npts = file.size / file.rowBytes;
+  }
+  if (file.dims == 0) {
+    throw std::runtime_error("ERROR(inspectDenseFile): Zero Dims " + path);
+  }
+  if (file.headerBytes + file.npts * file.rowBytes != file.size) {
+    throw std::runtime_error(std::format(
+        "ERROR(inspectDenseFile): File size mismatch for [{}], npts[{}], "
+        "dims[{}], {}",
+        path, file.npts, file.dims, elemName(elem)));
+  }
+  return file;
+}
+
+using ToFloatFn = void (*)(const char *src, uint64_t rows, uint32_t dims,
+                           uint64_t srcStride, float *dst);
+
+template <typename T>
+void rowsToFloat(const char *src, uint64_t rows, uint32_t dims,
+                 uint64_t srcStride, float *dst) {
+  for (uint64_t i{0}; i < rows; ++i) {
+    convertRow<T, float>(reinterpret_cast<const T *>(src + i * srcStride),
+                         dst + i * dims, dims);
+  }
+}
+
+template <std::size_t... E>
+constexpr std::array<ToFloatFn, kNumElemTypes>
+makeToFloat(std::index_sequence<E...>) {
+  return {&rowsToFloat<ElemOf<static_cast<ElemType>(E)>>...};
+}
+
+constexpr auto kToFloat =
+    makeToFloat(std::make_index_sequence<kNumElemTypes>{});
+
+// NOTE: pread rows [first, last) and hand them back as dense f32. An f32 bin
+// file is read straight into the result, everything else goes through a raw
+// buffer and the SIMD conversion kernels.
+inline std::vector<float> loadRows(const DenseFile &file, uint64_t first,
+                                   uint64_t last) {
+  const uint64_t rows{last - first};
+  std::vector<float> data(rows * file.dims);
+  bool direct{file.elem == ElemType::F32 && file.container == Container::Bin};
+  std::vector<char> raw{};
+  char *dst = reinterpret_cast<char *>(data.data());
+  if (!direct) {
+    raw.resize(rows * file.rowBytes);
+    dst = raw.data();
+  }
+
+  int fd = ::open(file.path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("ERROR(loadRows): Failed Open File " + file.path);
+  }
+  uint64_t offset{file.headerBytes + first * file.rowBytes};
+  uint64_t remaining{rows * file.rowBytes};
+  while (remaining > 0) {
+    ssize_t got = ::pread(fd, dst, remaining, offset);
+    if (got <= 0) {
+      ::close(fd);
+      throw std::runtime_error("ERROR(loadRows): Failed Read File " +
+                               file.path);
+    }
+    dst += got;
+    offset += got;
+    remaining -= got;
+  }
+  ::close(fd);
+
+  if (!direct) {
+    kToFloat[static_cast<std::size_t>(file.elem)](
+        raw.data() + rowPrefixBytes(file.container), rows, file.dims,
+        file.rowBytes, data.data());
+  }
+  return data;
+}
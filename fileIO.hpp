@@ -0,0 +1,73 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// NOTE: pwrite until all of [data, data + len) is at offset, safe to call
+// from several threads on one fd as long as the ranges do not overlap
+inline void writeAt(int fd, const void *data, uint64_t len, uint64_t offset) {
+  const char *buf = static_cast<const char *>(data);
+  while (len > 0) {
+    ssize_t written = ::pwrite(fd, buf, len, offset);
+    if (written <= 0) {
+      throw std::runtime_error("ERROR(writeAt): Failed Write Target File");
+    }
+    buf += written;
+    len -= written;
+    offset += written;
+  }
+}
+
+// NOTE: false when either path does not exist (yet)
+inline bool sameFile(const std::string &a, const std::string &b) {
+  std::error_code ec;
+  return std::filesystem::equivalent(a, b, ec);
+}
+
+// NOTE: Inputs are mapped and the target is truncated before it is written,
+// so a target that is also an input would be destroyed mid-run. Such a job
+// writes <target>.tmp instead, and commit() renames it over the target once
+// the output is complete; an unfinished tmp file is removed.
+class StagedTarget {
+ public:
+  StagedTarget(std::string target, std::initializer_list<std::string> inputs)
+      : target_(std::move(target)), path_(target_) {
+    for (const std::string &input : inputs) {
+      if (sameFile(input, target_)) {
+        path_ = target_ + ".tmp";
+        break;
+      }
+    }
+  }
+  StagedTarget(const StagedTarget &) = delete;
+  StagedTarget &operator=(const StagedTarget &) = delete;
+
+  ~StagedTarget() {
+    if (!committed_ && path_ != target_) {
+      std::error_code ec;
+      std::filesystem::remove(path_, ec);
+    }
+  }
+
+  // NOTE: where the job has to write its output
+  const std::string &path() const { return path_; }
+
+  void commit() {
+    if (path_ != target_) {
+      std::filesystem::rename(path_, target_);
+    }
+    committed_ = true;
+  }
+
+ private:
+  std::string target_;
+  std::string path_;
+  bool committed_{false};
+};
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// NOTE: Element types understood by the tools. The order of the enum must
+// match ElemTypeList, it is used to index the generated conversion matrix.
+enum class ElemType : uint8_t { U8, I8, U32, I32, F16, BF16, F32 };
+
+struct float16 {
+  uint16_t bits;
+};
+
+struct bfloat16 {
+  uint16_t bits;
+};
+
+using ElemTypeList =
+    std::tuple<uint8_t, int8_t, uint32_t, int32_t, float16, bfloat16, float>;
+
+constexpr std::size_t kNumElemTypes = std::tuple_size_v<ElemTypeList>;
+
+template <ElemType E>
+using ElemOf = std::tuple_element_t<static_cast<std::size_t>(E), ElemTypeList>;
+
+template <typename T> struct ElemTraits;
+
+template <> struct ElemTraits<uint8_t> {
+  static constexpr ElemType type = ElemType::U8;
+  static constexpr bool isFloat = false;
+};
+
+template <> struct ElemTraits<int8_t> {
+  static constexpr ElemType type = ElemType::I8;
+  static constexpr bool isFloat = false;
+};
+
+template <> struct ElemTraits<uint32_t> {
+  static constexpr ElemType type = ElemType::U32;
+  static constexpr bool isFloat = false;
+};
+
+template <> struct ElemTraits<int32_t> {
+  static constexpr ElemType type = ElemType::I32;
+  static constexpr bool isFloat = false;
+};
+
+template <> struct ElemTraits<float16> {
+  static constexpr ElemType type = ElemType::F16;
+  static constexpr bool isFloat = true;
+};
+
+template <> struct ElemTraits<bfloat16> {
+  static constexpr ElemType type = ElemType::BF16;
+  static constexpr bool isFloat = true;
+};
+
+template <> struct ElemTraits<float> {
+  static constexpr ElemType type = ElemType::F32;
+  static constexpr bool isFloat = true;
+};
+
+constexpr std::array<std::string_view, kNumElemTypes> kElemNames{
+    "u8", "i8", "u32", "i32", "f16", "bf16", "f32"};
+
+constexpr std::array<std::size_t, kNumElemTypes> kElemSizes{1, 1, 4, 4,
+                                                            2, 2, 4};
+
+constexpr std::string_view elemName(ElemType type) {
+  return kElemNames[static_cast<std::size_t>(type)];
+}
+
+constexpr std::size_t elemSize(ElemType type) {
+  return kElemSizes[static_cast<std::size_t>(type)];
+}
+
+// NOTE: Accepts the canonical names plus the aliases used by the older
+// command lines ([float], [uint]) and the BIGANN file prefixes (f, i, b).
+constexpr std::optional<ElemType> parseElemType(std::string_view name) {
+  for (std::size_t i{0}; i < kNumElemTypes; ++i) {
+    if (kElemNames[i] == name) {
+      return static_cast<ElemType>(i);
+    }
+  }
+  if (name == "uint8" || name == "b") return ElemType::U8;
+  if (name == "int8") return ElemType::I8;
+  if (name == "uint" || name == "uint32") return ElemType::U32;
+  if (name == "int" || name == "int32" || name == "i") return ElemType::I32;
+  if (name == "half" || name == "fp16" || name == "float16") {
+    return ElemType::F16;
+  }
+  if (name == "bfloat16") return ElemType::BF16;
+  if (name == "float" || name == "float32" || name == "f") {
+    return ElemType::F32;
+  }
+  return std::nullopt;
+}
+
+// NOTE: bin:  [npts(u32)][dims(u32)][npts * dims * T]
+//       vecs: npts * [dims(u32)][dims * T]
+enum class Container : uint8_t { Bin, Vecs };
+
+template <Container C> struct ContainerTraits;
+
+template <> struct ContainerTraits<Container::Bin> {
+  static constexpr std::size_t fileHeaderBytes = 2 * sizeof(uint32_t);
+  static constexpr std::size_t rowPrefixBytes = 0;
+};
+
+template <> struct ContainerTraits<Container::Vecs> {
+  static constexpr std::size_t fileHeaderBytes = 0;
+  static constexpr std::size_t rowPrefixBytes = sizeof(uint32_t);
+};
+
+constexpr std::size_t fileHeaderBytes(Container container) {
+  return container == Container::Bin
+             ? ContainerTraits<Container::Bin>::fileHeaderBytes
+             : ContainerTraits<Container::Vecs>::fileHeaderBytes;
+}
+
+constexpr std::size_t rowPrefixBytes(Container container) {
+  return container == Container::Bin
+             ? ContainerTraits<Container::Bin>::rowPrefixBytes
+             : ContainerTraits<Container::Vecs>::rowPrefixBytes;
+}
+
+struct Format {
+  Container container;
+  // NOTE: empty for the untyped [bin] / [vecs] formats
+  std::optional<ElemType> elem;
+};
+
+// NOTE: [bin], [vecs], or a typed name such as fbin, u8bin, i8bin, f16bin,
+// bf16bin, fvecs, ivecs, bvecs
+constexpr std::optional<Format> parseFormat(std::string_view name) {
+  Container container{Container::Bin};
+  std::string_view prefix{};
+  if (name.ends_with("bin")) {
+    prefix = name.substr(0, name.size() - 3);
+  } else if (name.ends_with("vecs")) {
+    container = Container::Vecs;
+    prefix = name.substr(0, name.size() - 4);
+  } else {
+    return std::nullopt;
+  }
+  if (prefix.empty()) {
+    return Format{container, std::nullopt};
+  }
+  std::optional<ElemType> elem{parseElemType(prefix)};
+  if (!elem) {
+    return std::nullopt;
+  }
+  return Format{container, elem};
+}
+
+inline float halfToFloat(uint16_t h) {
+  uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  uint32_t exp = (h >> 10) & 0x1Fu;
+  uint32_t mant = h & 0x3FFu;
+  if (exp == 0x1F) {
+    // NOTE: NaN keeps its payload and comes back quiet, as F16C does
+    return std::bit_cast<float>(sign | 0x7F800000u | (mant << 13) |
+                                (mant != 0 ? 0x400000u : 0u));
+  }
+  if (exp == 0) {
+    // NOTE: subnormal half, mant * 2^-24
+    float value = static_cast<float>(mant) * 5.9604644775390625e-8f;
+    return sign ? -value : value;
+  }
+  return std::bit_cast<float>(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+// NOTE: round-to-nearest-even, overflow goes to inf, NaN stays quiet NaN
+// with the top payload bits, matching the F16C instructions
+inline uint16_t floatToHalf(float value) {
+  uint32_t bits = std::bit_cast<uint32_t>(value);
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  uint32_t absBits = bits & 0x7FFFFFFFu;
+  if (absBits >= 0x7F800000u) {
+    uint32_t payload =
+        absBits > 0x7F800000u ? 0x200u | ((absBits >> 13) & 0x3FFu) : 0u;
+    return static_cast<uint16_t>(sign | 0x7C00u | payload);
+  }
+  if (absBits >= 0x477FF000u) {
+    return static_cast<uint16_t>(sign | 0x7C00u);
+  }
+  if (absBits < 0x38800000u) {
+    // NOTE: adding 0.5f lines the half subnormal step (2^-24) up with the
+    // float ulp, so the FPU does the rounding for us
+    float shifted = std::bit_cast<float>(absBits) + 0.5f;
+    return static_cast<uint16_t>(
+        sign | (std::bit_cast<uint32_t>(shifted) - 0x3F000000u));
+  }
+  uint32_t mantOdd = (absBits >> 13) & 1u;
+  absBits += 0xC8000FFFu + mantOdd;
+  return static_cast<uint16_t>(sign | (absBits >> 13));
+}
+
+inline float bf16ToFloat(uint16_t b) {
+  return std::bit_cast<float>(static_cast<uint32_t>(b) << 16);
+}
+
+inline uint16_t floatToBf16(float value) {
+  uint32_t bits = std::bit_cast<uint32_t>(value);
+  if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+    return static_cast<uint16_t>((bits >> 16) | 0x40u);
+  }
+  bits += 0x7FFFu + ((bits >> 16) & 1u);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+template <typename T> inline float toFloat(T value) {
+  if constexpr (std::is_same_v<T, float16>) {
+    return halfToFloat(value.bits);
+  } else if constexpr (std::is_same_v<T, bfloat16>) {
+    return bf16ToFloat(value.bits);
+  } else {
+    return static_cast<float>(value);
+  }
+}
+
+// NOTE: integer targets round to nearest and saturate, NaN maps to the
+// lower bound (the same result the SIMD kernels give)
+template <typename T> inline T fromFloat(float value) {
+  if constexpr (std::is_same_v<T, float16>) {
+    return float16{floatToHalf(value)};
+  } else if constexpr (std::is_same_v<T, bfloat16>) {
+    return bfloat16{floatToBf16(value)};
+  } else if constexpr (std::is_same_v<T, float>) {
+    return value;
+  } else {
+    constexpr double lo = std::numeric_limits<T>::min();
+    constexpr double hi = std::numeric_limits<T>::max();
+    double v = value;
+    v = v > lo ? v : lo;
+    v = v < hi ? v : hi;
+    return static_cast<T>(std::nearbyint(v));
+  }
+}
+
+template <typename S, typename D> inline D convertValue(S value) {
+  if constexpr (std::is_same_v<S, D>) {
+    return value;
+  } else if constexpr (ElemTraits<S>::isFloat || ElemTraits<D>::isFloat) {
+    return fromFloat<D>(toFloat(value));
+  } else {
+    int64_t v = static_cast<int64_t>(value);
+    constexpr int64_t lo = std::numeric_limits<D>::min();
+    constexpr int64_t hi = std::numeric_limits<D>::max();
+    return static_cast<D>(v < lo ? lo : (v > hi ? hi : v));
+  }
+}
+
+#if defined(__AVX2__)
+namespace simd {
+
+inline std::size_t widenU8ToF32(const uint8_t *src, float *dst,
+                                std::size_t n) {
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)));
+  }
+  return i;
+}
+
+inline std::size_t widenI8ToF32(const int8_t *src, float *dst,
+                                std::size_t n) {
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes)));
+  }
+  return i;
+}
+
+inline std::size_t widenBf16ToF32(const bfloat16 *src, float *dst,
+                                  std::size_t n) {
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    __m128i halves =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(halves), 16);
+    _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(bits));
+  }
+  return i;
+}
+
+inline std::size_t narrowF32ToBf16(const float *src, bfloat16 *dst,
+                                   std::size_t n) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i bias = _mm256_set1_epi32(0x7FFF);
+  const __m256i quiet = _mm256_set1_epi32(0x40);
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(src + i);
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+    __m256i rounded = _mm256_srli_epi32(
+        _mm256_add_epi32(bits, _mm256_add_epi32(bias, lsb)), 16);
+    __m256i nan = _mm256_or_si256(_mm256_srli_epi32(bits, 16), quiet);
+    __m256i isNan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    __m256i res = _mm256_blendv_epi8(rounded, nan, isNan);
+    __m256i packed =
+        _mm256_permute4x64_epi64(_mm256_packus_epi32(res, res), 0xD8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm256_castsi256_si128(packed));
+  }
+  return i;
+}
+
+template <typename D>
+inline std::size_t narrowF32ToByte(const float *src, D *dst, std::size_t n) {
+  constexpr float lo = std::numeric_limits<D>::min();
+  constexpr float hi = std::numeric_limits<D>::max();
+  const __m256 vlo = _mm256_set1_ps(lo);
+  const __m256 vhi = _mm256_set1_ps(hi);
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    // NOTE: max(v, lo) returns lo for NaN, clamping before the convert keeps
+    // out-of-range values from turning into INT_MIN
+    __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), vlo), vhi);
+    __m256i words = _mm256_cvtps_epi32(v);
+    __m128i shorts = _mm_packs_epi32(_mm256_castsi256_si128(words),
+                                     _mm256_extracti128_si256(words, 1));
+    __m128i bytes;
+    if constexpr (std::is_signed_v<D>) {
+      bytes = _mm_packs_epi16(shorts, shorts);
+    } else {
+      bytes = _mm_packus_epi16(shorts, shorts);
+    }
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), bytes);
+  }
+  return i;
+}
+
+#if defined(__F16C__)
+inline std::size_t widenF16ToF32(const float16 *src, float *dst,
+                                 std::size_t n) {
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    __m128i halves =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(halves));
+  }
+  return i;
+}
+
+inline std::size_t narrowF32ToF16(const float *src, float16 *dst,
+                                  std::size_t n) {
+  std::size_t i{0};
+  for (; i + 8 <= n; i += 8) {
+    __m128i halves =
+        _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), halves);
+  }
+  return i;
+}
+#endif
+
+}  // namespace simd
+#endif
+
+// NOTE: Convert n elements from S to D in one pass. The widen/narrow pairs
+// that show up in practice (byte/half <-> f32) get SIMD kernels, everything
+// else goes through convertValue.
+template <typename S, typename D>
+inline void convertRow(const S *src, D *dst, std::size_t n) {
+  if constexpr (std::is_same_v<S, D>) {
+    std::memcpy(dst, src, n * sizeof(S));
+    return;
+  } else {
+    std::size_t done{0};
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<S, uint8_t> && std::is_same_v<D, float>) {
+      done = simd::widenU8ToF32(src, dst, n);
+    } else if constexpr (std::is_same_v<S, int8_t> &&
+                         std::is_same_v<D, float>) {
+      done = simd::widenI8ToF32(src, dst, n);
+    } else if constexpr (std::is_same_v<S, bfloat16> &&
+                         std::is_same_v<D, float>) {
+      done = simd::widenBf16ToF32(src, dst, n);
+    } else if constexpr (std::is_same_v<S, float> &&
+                         std::is_same_v<D, bfloat16>) {
+      done = simd::narrowF32ToBf16(src, dst, n);
+    } else if constexpr (std::is_same_v<S, float> &&
+                         (std::is_same_v<D, uint8_t> ||
+                          std::is_same_v<D, int8_t>)) {
+      done = simd::narrowF32ToByte(src, dst, n);
+    }
+#if defined(__F16C__)
+    if constexpr (std::is_same_v<S, float16> && std::is_same_v<D, float>) {
+      done = simd::widenF16ToF32(src, dst, n);
+    } else if constexpr (std::is_same_v<S, float> &&
+                         std::is_same_v<D, float16>) {
+      done = simd::narrowF32ToF16(src, dst, n);
+    }
+#endif
+#endif
+    for (std::size_t i{done}; i < n; ++i) {
+      dst[i] = convertValue<S, D>(src[i]);
+    }
+  }
+}
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include "parseList.hpp"
+
+// NOTE: base codes scanned by a query block before moving on, 4096 x 32
+// byte codes is 128 KiB and stays in L2 while the block reuses it
+constexpr uint64_t kBaseTileRows = 4096;
+// NOTE: queries per work item
+constexpr uint64_t kQueryBlock = 64;
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+// NOTE: u8bin code file written by ./sketch, [npts][code bytes][codes]
+struct CodeFile {
+  MappedFile file;
+  uint32_t npts{0};
+  uint32_t bytes{0};
+
+  const uint8_t *code(uint64_t i) const {
+    return file.as<uint8_t>(2 * sizeof(uint32_t) + i * bytes);
+  }
+};
+
+CodeFile mapCodeFile(const std::string &path) {
+  CodeFile codes{MappedFile(path)};
+  if (codes.file.size() < 2 * sizeof(uint32_t)) {
+    throw std::runtime_error(
+        std::format("ERROR(mapCodeFile): File Too Small [{}]", path));
+  }
+  codes.npts = codes.file.as<uint32_t>()[0];
+  codes.bytes = codes.file.as<uint32_t>()[1];
+  if (codes.file.size() !=
+      2 * sizeof(uint32_t) + uint64_t{codes.npts} * codes.bytes) {
+    throw std::runtime_error(std::format(
+        "ERROR(mapCodeFile): File size mismatch for [{}], npts[{}], bytes[{}]",
+        path, codes.npts, codes.bytes));
+  }
+  return codes;
+}
+
+inline uint64_t load64(const uint8_t *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// NOTE: W is the code length in 64-bit words when it is known at compile
+// time, W == 0 is the generic path (any byte length)
+template <uint32_t W>
+inline uint32_t hamming(const uint8_t *a, const uint8_t *b, uint32_t bytes) {
+  uint32_t dist{0};
+  if constexpr (W > 0) {
+    for (uint32_t w{0}; w < W; ++w) {
+      dist += std::popcount(load64(a + 8 * w) ^ load64(b + 8 * w));
+    }
+  } else {
+    uint32_t i{0};
+    for (; i + 8 <= bytes; i += 8) {
+      dist += std::popcount(load64(a + i) ^ load64(b + i));
+    }
+    for (; i < bytes; ++i) {
+      dist += std::popcount(static_cast<uint8_t>(a[i] ^ b[i]));
+    }
+  }
+  return dist;
+}
+
+struct Candidate {
+  uint32_t dist;
+  uint32_t id;
+};
+
+inline bool isBetter(const Candidate &a, const Candidate &b) {
+  return a.dist < b.dist || (a.dist == b.dist && a.id < b.id);
+}
+
+// NOTE: Brute-force Hamming top-K. Base ids are visited in increasing order,
+// so a candidate tied with the current worst can never win the id tie-break
+// and the scan rejects everything not strictly closer.
+template <uint32_t W>
+void searchBlock(const CodeFile &base, const CodeFile &query, uint64_t qBegin,
+                 uint64_t qEnd, uint32_t k,
+                 std::vector<std::vector<Candidate>> &topk) {
+  const uint32_t bytes{base.bytes};
+  for (uint64_t tb{0}; tb < base.npts; tb += kBaseTileRows) {
+    uint64_t te{std::min<uint64_t>(base.npts, tb + kBaseTileRows)};
+    for (uint64_t q{qBegin}; q < qEnd; ++q) {
+      const uint8_t *qc = query.code(q);
+      std::vector<Candidate> &heap = topk[q];
+      uint32_t worst{heap.size() == k ? heap.front().dist : UINT32_MAX};
+      const uint8_t *bc = base.code(tb);
+      for (uint64_t i{tb}; i < te; ++i, bc += bytes) {
+        uint32_t dist{hamming<W>(qc, bc, bytes)};
+        if (dist >= worst) {
+          continue;
+        }
+        if (heap.size() < k) {
+          heap.push_back({dist, static_cast<uint32_t>(i)});
+          std::push_heap(heap.begin(), heap.end(), isBetter);
+        } else {
+          std::pop_heap(heap.begin(), heap.end(), isBetter);
+          heap.back() = {dist, static_cast<uint32_t>(i)};
+          std::push_heap(heap.begin(), heap.end(), isBetter);
+        }
+        if (heap.size() == k) {
+          worst = heap.front().dist;
+        }
+      }
+    }
+  }
+}
+
+using SearchFn = void (*)(const CodeFile &, const CodeFile &, uint64_t,
+                          uint64_t, uint32_t,
+                          std::vector<std::vector<Candidate>> &);
+
+SearchFn pickSearch(uint32_t bytes) {
+  switch (bytes) {
+    case 8:
+      return &searchBlock<1>;
+    case 16:
+      return &searchBlock<2>;
+    case 32:
+      return &searchBlock<4>;
+    case 64:
+      return &searchBlock<8>;
+    case 128:
+      return &searchBlock<16>;
+    default:
+      return &searchBlock<0>;
+  }
+}
+
+// NOTE: result in the GT bin layout ([nq][K][ids][dists as f32]), so it can
+// also be scored with ./compute_recall_std
+void writeResult(const std::string &path, uint32_t k,
+                 std::vector<std::vector<Candidate>> &topk) {
+  const uint32_t nq = topk.size();
+  std::vector<uint32_t> ids(uint64_t{nq} * k);
+  std::vector<float> dists(uint64_t{nq} * k);
+  for (uint64_t q{0}; q < nq; ++q) {
+    std::sort(topk[q].begin(), topk[q].end(), isBetter);
+    for (uint32_t i{0}; i < k; ++i) {
+      ids[q * k + i] = topk[q][i].id;
+      dists[q * k + i] = topk[q][i].dist;
+    }
+  }
+  std::ofstream writer(path, std::ios::binary);
+  if (!writer.is_open()) {
+    throw std::runtime_error("ERROR(writeResult): Failed Open File " + path);
+  }
+  writer.write(reinterpret_cast<const char *>(&nq), sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(&k), sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(ids.data()),
+               ids.size() * sizeof(uint32_t));
+  writer.write(reinterpret_cast<const char *>(dists.data()),
+               dists.size() * sizeof(float));
+}
+
+// NOTE: Sketch recall as a candidate filter: for each k, the fraction of the
+// float top-k (first k ids of the GT) found among the K Hamming candidates.
+// With K == k this is the usual recall@k.
+void reportSketchRecall(const std::string &gtPath,
+                        const std::vector<std::vector<Candidate>> &topk,
+                        uint32_t candidates, std::vector<uint32_t> ks) {
+  MappedFile gt(gtPath);
+  if (gt.size() < 2 * sizeof(uint32_t)) {
+    throw std::runtime_error(
+        std::format("ERROR(reportSketchRecall): File Too Small [{}]", gtPath));
+  }
+  const uint32_t gtQueries{gt.as<uint32_t>()[0]};
+  const uint32_t gtDims{gt.as<uint32_t>()[1]};
+  if (gt.size() < 2 * sizeof(uint32_t) +
+                      uint64_t{gtQueries} * gtDims * sizeof(uint32_t) ||
+      gtQueries != topk.size()) {
+    throw std::runtime_error(std::format(
+        "ERROR(reportSketchRecall): GT [{}] has {} queries, sketch has {}",
+        gtPath, gtQueries, topk.size()));
+  }
+  const uint32_t *gtIds = gt.as<uint32_t>(2 * sizeof(uint32_t));
+
+  std::cout << std::format("Sketch Recall vs {} ({} Hamming candidates)",
+                           gtPath, candidates)
+            << std::endl;
+  for (uint32_t k : ks) {
+    if (k == 0 || k > gtDims || k > candidates) {
+      std::cout << std::format("  skip k={}: needs 0 < k <= min(GT K {}, {})",
+                               k, gtDims, candidates)
+                << std::endl;
+      continue;
+    }
+    double total{0};
+    for (uint64_t q{0}; q < gtQueries; ++q) {
+      std::vector<uint32_t> found{};
+      found.reserve(topk[q].size());
+      for (const Candidate &c : topk[q]) {
+        found.push_back(c.id);
+      }
+      std::sort(found.begin(), found.end());
+      uint32_t hits{0};
+      for (uint32_t i{0}; i < k; ++i) {
+        hits += std::binary_search(found.begin(), found.end(),
+                                   gtIds[q * gtDims + i]);
+      }
+      total += static_cast<double>(hits) / k;
+    }
+    std::cout << std::format("  recall {}@{}: {:.4f}", k, candidates,
+                             total / std::max<uint32_t>(1, gtQueries))
+              << std::endl;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 5 || argc % 2 == 0) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./hamming_knn [base codes] [query codes] "
+                 "[result path] [K] [--gt float gt path] [--k 1,10,100] "
+                 "[--threads N]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string basePath{argv[1]};
+  std::string queryPath{argv[2]};
+  std::string resultPath{argv[3]};
+  std::string gtPath{};
+  std::vector<uint32_t> ks{1, 10, 100};
+  uint32_t k{0};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(basePath);
+    checkFileExists(queryPath);
+    checkSidecar(basePath);
+    checkSidecar(queryPath);
+    k = std::stoul(argv[4]);
+    for (int i{5}; i + 1 < argc; i += 2) {
+      std::string option{argv[i]};
+      if (option == "--gt") {
+        gtPath = argv[i + 1];
+        checkFileExists(gtPath);
+        checkSidecar(gtPath);
+      } else if (option == "--k") {
+        ks = parseKList(argv[i + 1]);
+      } else if (option == "--threads") {
+        threads = std::max(1, std::stoi(argv[i + 1]));
+      } else {
+        throw std::runtime_error("Unknown Option: " + option);
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [K], [--k] and [--threads] must be integers."
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  try {
+    CodeFile base{mapCodeFile(basePath)};
+    CodeFile query{mapCodeFile(queryPath)};
+    if (base.bytes != query.bytes) {
+      throw std::runtime_error(
+          std::format("Base codes are {} bytes, query codes are {} bytes",
+                      base.bytes, query.bytes));
+    }
+    k = std::min(k, base.npts);
+    if (k == 0) {
+      throw std::runtime_error("K must be positive and base not empty");
+    }
+    std::cout << std::format("Base: npts[{}]; Query: npts[{}]; {} bits, K[{}]",
+                             base.npts, query.npts, base.bytes * 8, k)
+              << std::endl;
+
+    base.file.adviseWillNeed();
+    std::vector<std::vector<Candidate>> topk(query.npts);
+    SearchFn search{pickSearch(base.bytes)};
+    parallelFor(
+        0, query.npts, kQueryBlock,
+        [&](uint64_t begin, uint64_t end, unsigned) {
+          search(base, query, begin, end, k, topk);
+        },
+        threads);
+    writeResult(resultPath, k, topk);
+    std::cout << "Save Result Into " << resultPath << std::endl;
+
+    if (!gtPath.empty()) {
+      reportSketchRecall(gtPath, topk, k, ks);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Hamming Search Done!" << std::endl;
+}
@@ -0,0 +1,325 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "fileIO.hpp"
+#include "formatTraits.hpp"
+#include "layoutFile.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include "parseList.hpp"
+
+// NOTE: target bytes produced per work item / per pwrite
+constexpr uint64_t kChunkBytes = 4UL << 20;
+// NOTE: sub-tile edge of the cache blocked transpose
+constexpr uint64_t kTransposeTile = 32;
+// NOTE: option bounds, a block is one SIMD batch of rows and the padded
+// file grows with it, so anything past a few thousand rows is a typo
+constexpr uint32_t kMaxBlockRows = 1U << 16;
+constexpr unsigned kMaxThreads = 1024;
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+struct DenseSource {
+  MappedFile file;
+  Container container;
+  uint64_t npts{0};
+  uint32_t dims{0};
+  uint64_t rowBytes{0};
+
+  template <typename T> const T *row(uint64_t i) const {
+    return file.as<T>(fileHeaderBytes(container) + i * rowBytes +
+                      rowPrefixBytes(container));
+  }
+};
+
+DenseSource openDenseSource(const std::string &path, Container container,
+                            std::size_t elemBytes) {
+  DenseSource source{MappedFile(path), container};
+  const MappedFile &file = source.file;
+  if (file.size() < fileHeaderBytes(container) + sizeof(uint32_t)) {
+    throw std::runtime_error("Source file too small: " + path);
+  }
+  if (container == Container::Bin) {
+    source.npts = file.as<uint32_t>()[0];
+    source.dims = file.as<uint32_t>()[1];
+    source.rowBytes = source.dims * elemBytes;
+  } else {
+    source.dims = file.as<uint32_t>()[0];
+    source.rowBytes = rowPrefixBytes(container) + source.dims * elemBytes;
+    source.npts = file.size() / source.rowBytes;
+  }
+  if (source.dims == 0) {
+    throw std::runtime_error("Source file has zero dims: " + path);
+  }
+  uint64_t expectSize{fileHeaderBytes(container) +
+                      source.npts * source.rowBytes};
+  if (expectSize != file.size()) {
+    throw std::runtime_error(
+        std::format("File size mismatch: Expected {} bytes, but got {} bytes "
+                    "for file: {}",
+                    expectSize, file.size(), path));
+  }
+  return source;
+}
+
+// NOTE: "0,4,8-15" -> {0, 4, 8, ..., 15}, ranges are inclusive
+std::vector<uint32_t> parseDimSpec(const std::string &spec, uint32_t dims) {
+  std::vector<uint32_t> dimMap;
+  for (const IdRange &range : parseRangeList(spec)) {
+    if (range.last >= dims) {
+      throw std::runtime_error(
+          std::format("Dimension spec [{}-{}] out of range for dims[{}]",
+                      range.first, range.last, dims));
+    }
+    for (uint64_t j{range.first}; j <= range.last; ++j) {
+      dimMap.push_back(static_cast<uint32_t>(j));
+    }
+  }
+  return dimMap;
+}
+
+// NOTE: out[j * stride + (i - r0)] = source[i][dimMap[j]] for the rows
+// [r0, r0 + rows), walked in kTransposeTile square tiles so both the source
+// rows and the strided destination stay in cache.
+template <typename T>
+void transposeTile(const DenseSource &source,
+                   const std::vector<uint32_t> &dimMap, uint64_t r0,
+                   uint64_t rows, T *out, uint64_t stride) {
+  const uint64_t dims{dimMap.size()};
+  for (uint64_t ib{0}; ib < rows; ib += kTransposeTile) {
+    uint64_t ie{std::min(rows, ib + kTransposeTile)};
+    for (uint64_t jb{0}; jb < dims; jb += kTransposeTile) {
+      uint64_t je{std::min(dims, jb + kTransposeTile)};
+      for (uint64_t i{ib}; i < ie; ++i) {
+        const T *row = source.row<T>(r0 + i);
+        for (uint64_t j{jb}; j < je; ++j) {
+          out[j * stride + i] = row[dimMap[j]];
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void exportLayout(const DenseSource &source,
+                  const std::vector<uint32_t> &dimMap,
+                  const LayoutHeader &header, int fd, unsigned threads) {
+  const uint64_t npts{header.npts};
+  const uint64_t dims{header.dims};
+  const uint64_t rowOut{dims * sizeof(T)};
+  bool identity{dimMap.size() == source.dims &&
+                std::is_sorted(dimMap.begin(), dimMap.end()) &&
+                std::adjacent_find(dimMap.begin(), dimMap.end()) ==
+                    dimMap.end()};
+
+  switch (header.kind) {
+    case LayoutKind::Row: {
+      uint64_t grain{std::max<uint64_t>(1, kChunkBytes / rowOut)};
+      parallelFor(
+          0, npts, grain,
+          [&](uint64_t begin, uint64_t end, unsigned) {
+            std::unique_ptr<T[]> buf =
+                std::make_unique<T[]>((end - begin) * dims);
+            for (uint64_t i{begin}; i < end; ++i) {
+              const T *row = source.row<T>(i);
+              T *dst = buf.get() + (i - begin) * dims;
+              if (identity) {
+                std::memcpy(dst, row, rowOut);
+              } else {
+                for (uint64_t j{0}; j < dims; ++j) {
+                  dst[j] = row[dimMap[j]];
+                }
+              }
+            }
+            writeAt(fd, buf.get(), (end - begin) * rowOut,
+                    header.dataOffset + begin * rowOut);
+          },
+          threads);
+      break;
+    }
+    case LayoutKind::Blocked: {
+      const uint64_t blockRows{header.blockRows};
+      const uint64_t blockElems{blockRows * dims};
+      const uint64_t numBlocks{header.paddedRows / blockRows};
+      uint64_t grain{
+          std::max<uint64_t>(1, kChunkBytes / (blockElems * sizeof(T)))};
+      parallelFor(
+          0, numBlocks, grain,
+          [&](uint64_t begin, uint64_t end, unsigned) {
+            // NOTE: value-initialised, so the tail of the last block is zero
+            std::unique_ptr<T[]> buf =
+                std::make_unique<T[]>((end - begin) * blockElems);
+            for (uint64_t b{begin}; b < end; ++b) {
+              uint64_t r0{b * blockRows};
+              uint64_t rows{std::min(blockRows, npts - r0)};
+              transposeTile<T>(source, dimMap, r0, rows,
+                               buf.get() + (b - begin) * blockElems,
+                               blockRows);
+            }
+            writeAt(fd, buf.get(), (end - begin) * blockElems * sizeof(T),
+                    header.dataOffset + begin * blockElems * sizeof(T));
+          },
+          threads);
+      break;
+    }
+    case LayoutKind::Column: {
+      uint64_t grain{std::max<uint64_t>(kTransposeTile, kChunkBytes / rowOut)};
+      parallelFor(
+          0, npts, grain,
+          [&](uint64_t begin, uint64_t end, unsigned) {
+            uint64_t rows{end - begin};
+            std::unique_ptr<T[]> buf = std::make_unique<T[]>(rows * dims);
+            transposeTile<T>(source, dimMap, begin, rows, buf.get(), rows);
+            for (uint64_t j{0}; j < dims; ++j) {
+              writeAt(fd, buf.get() + j * rows, rows * sizeof(T),
+                      header.dataOffset + (j * npts + begin) * sizeof(T));
+            }
+          },
+          threads);
+      break;
+    }
+  }
+}
+
+void layout(const std::string &sourcePath, Container container, ElemType elem,
+            const std::string &targetPath, LayoutKind kind,
+            uint32_t blockRows, const std::string &dimSpec,
+            unsigned threads) {
+  DenseSource source{openDenseSource(sourcePath, container, elemSize(elem))};
+  source.file.adviseSequential();
+
+  std::vector<uint32_t> dimMap(source.dims);
+  if (dimSpec.empty()) {
+    std::iota(dimMap.begin(), dimMap.end(), 0);
+  } else {
+    dimMap = parseDimSpec(dimSpec, source.dims);
+  }
+
+  LayoutHeader header{makeLayoutHeader(
+      kind, elem, source.npts, static_cast<uint32_t>(dimMap.size()),
+      blockRows)};
+  std::cout << std::format(
+                   "Source Data Info: npts[{}], dims[{}], type[{}] -> "
+                   "layout[{}], dims[{}], blockRows[{}]",
+                   source.npts, source.dims, elemName(elem), layoutName(kind),
+                   header.dims, header.blockRows)
+            << std::endl;
+
+  StagedTarget staged(targetPath, {sourcePath});
+  int fd = ::open(staged.path().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error(
+        std::format("ERROR(layout): Failed Open File [{}]", targetPath));
+  }
+  try {
+    if (::ftruncate(fd, header.dataOffset + layoutDataBytes(header)) != 0) {
+      throw std::runtime_error("ERROR(layout): Failed Resize Target File");
+    }
+    writeAt(fd, &header, sizeof(header), 0);
+    writeAt(fd, dimMap.data(), dimMap.size() * sizeof(uint32_t),
+            sizeof(header));
+    switch (elemSize(elem)) {
+      case 1:
+        exportLayout<uint8_t>(source, dimMap, header, fd, threads);
+        break;
+      case 2:
+        exportLayout<uint16_t>(source, dimMap, header, fd, threads);
+        break;
+      default:
+        exportLayout<uint32_t>(source, dimMap, header, fd, threads);
+        break;
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  staged.commit();
+}
+
+int main(int argc, char **argv) {
+  if (argc < 5 || argc % 2 == 0) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./layout [source dataset path] "
+                 "[source dataset format] [target path] [row|blocked|column] "
+                 "[--block N(default 16)] [--dims 0,4,8-15] "
+                 "[--type data type] [--threads N]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string sourcePath{argv[1]};
+  std::string sourceFormat{argv[2]};
+  std::string targetPath{argv[3]};
+  std::string layoutArg{argv[4]};
+  std::string dimSpec{};
+  std::string dataType{};
+  uint32_t blockRows{16};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(sourcePath);
+    checkSidecar(sourcePath);
+    for (int i{5}; i + 1 < argc; i += 2) {
+      std::string option{argv[i]};
+      if (option == "--block") {
+        blockRows = parseUnsigned(argv[i + 1], kMaxBlockRows);
+      } else if (option == "--dims") {
+        dimSpec = argv[i + 1];
+      } else if (option == "--type") {
+        dataType = argv[i + 1];
+      } else if (option == "--threads") {
+        threads = parseUnsigned(argv[i + 1], kMaxThreads);
+      } else {
+        throw std::runtime_error("Unknown Option: " + option);
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [--block] and [--threads] must be integers, "
+              << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::optional<Format> format{parseFormat(sourceFormat)};
+  std::optional<LayoutKind> kind{parseLayoutKind(layoutArg)};
+  std::optional<ElemType> elem{format ? format->elem : std::nullopt};
+  if (!dataType.empty()) {
+    elem = parseElemType(dataType);
+  }
+  if (!format || !kind || !elem || blockRows == 0) {
+    std::cerr << "ERROR: Input format, layout, data type or block size does "
+                 "not meet requirements"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  try {
+    layout(sourcePath, format->container, *elem, targetPath, *kind, blockRows,
+           dimSpec, threads);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Layout Done!" << std::endl;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "formatTraits.hpp"
+#include "mappedFile.hpp"
+
+// NOTE: Layout file written by ./layout
+//   [LayoutHeader][dims x uint32 source dimension][zero pad to dataOffset]
+//   [data]
+// row:     element (i, j) at i * dims + j
+// blocked: rows are grouped into blocks of blockRows rows (the last block is
+//          zero padded), inside a block dimension j holds blockRows
+//          consecutive values: (i, j) at ((i / B) * dims + j) * B + i % B
+// column:  element (i, j) at j * npts + i
+enum class LayoutKind : uint8_t { Row, Blocked, Column };
+
+constexpr char kLayoutMagic[8] = {'V', 'T', 'L', 'A', 'Y', 'O', 'U', 'T'};
+constexpr uint32_t kLayoutVersion = 1;
+constexpr uint64_t kLayoutAlign = 64;
+
+struct LayoutHeader {
+  char magic[8];
+  uint32_t version;
+  LayoutKind kind;
+  ElemType elem;
+  uint16_t reserved;
+  uint64_t npts;
+  uint32_t dims;
+  uint32_t blockRows;
+  uint64_t paddedRows;
+  uint64_t dataOffset;
+};
+
+static_assert(sizeof(LayoutHeader) == 48);
+
+constexpr std::string_view layoutName(LayoutKind kind) {
+  switch (kind) {
+    case LayoutKind::Row:
+      return "row";
+    case LayoutKind::Blocked:
+      return "blocked";
+    case LayoutKind::Column:
+      return "column";
+  }
+  return "unknown";
+}
+
+constexpr std::optional<LayoutKind> parseLayoutKind(std::string_view name) {
+  if (name == "row") return LayoutKind::Row;
+  if (name == "blocked") return LayoutKind::Blocked;
+  if (name == "column") return LayoutKind::Column;
+  return std::nullopt;
+}
+
+inline LayoutHeader makeLayoutHeader(LayoutKind kind, ElemType elem,
+                                     uint64_t npts, uint32_t dims,
+                                     uint32_t blockRows) {
+  LayoutHeader header{};
+  std::memcpy(header.magic, kLayoutMagic, sizeof(kLayoutMagic));
+  header.version = kLayoutVersion;
+  header.kind = kind;
+  header.elem = elem;
+  header.npts = npts;
+  header.dims = dims;
+  header.blockRows = kind == LayoutKind::Blocked ? blockRows : 0;
+  header.paddedRows =
+      kind == LayoutKind::Blocked
+          ? (npts + blockRows - 1) / blockRows * blockRows
+          : npts;
+  uint64_t metaBytes{sizeof(LayoutHeader) + dims * sizeof(uint32_t)};
+  header.dataOffset = (metaBytes + kLayoutAlign - 1) / kLayoutAlign *
+                      kLayoutAlign;
+  return header;
+}
+
+inline uint64_t layoutDataBytes(const LayoutHeader &header) {
+  return header.paddedRows * header.dims * elemSize(header.elem);
+}
+
+// NOTE: Zero-copy reader over a layout file, data pointers point straight
+// into the mapping (dataOffset is 64-byte aligned).
+class LayoutReader {
+ public:
+  explicit LayoutReader(const std::string &path) : file_(path) {
+    if (file_.size() < sizeof(LayoutHeader)) {
+      throw std::runtime_error(
+          std::format("ERROR(LayoutReader): File Too Small [{}]", path));
+    }
+    std::memcpy(&header_, file_.data(), sizeof(LayoutHeader));
+    if (std::memcmp(header_.magic, kLayoutMagic, sizeof(kLayoutMagic)) != 0 ||
+        header_.version != kLayoutVersion) {
+      throw std::runtime_error(
+          std::format("ERROR(LayoutReader): Not A Layout File [{}]", path));
+    }
+    checkHeader(path);
+    if (file_.size() != header_.dataOffset + layoutDataBytes(header_)) {
+      throw std::runtime_error(
+          std::format("ERROR(LayoutReader): File Size Mismatch [{}]", path));
+    }
+  }
+
+  const LayoutHeader &header() const { return header_; }
+  LayoutKind kind() const { return header_.kind; }
+  ElemType elem() const { return header_.elem; }
+  uint64_t npts() const { return header_.npts; }
+  uint32_t dims() const { return header_.dims; }
+  uint32_t blockRows() const { return header_.blockRows; }
+  uint64_t numBlocks() const {
+    return header_.blockRows == 0 ? 0 : header_.paddedRows / header_.blockRows;
+  }
+
+  // NOTE: dimension of the source file stored at projected dimension j
+  uint32_t sourceDim(uint32_t j) const {
+    return file_.as<uint32_t>(sizeof(LayoutHeader))[j];
+  }
+
+  template <typename T> const T *data() const {
+    checkElem<T>();
+    return file_.as<T>(header_.dataOffset);
+  }
+
+  // NOTE: blocked layout, dims x blockRows values of block b
+  template <typename T> const T *block(uint64_t b) const {
+    return data<T>() + b * header_.dims * header_.blockRows;
+  }
+
+  // NOTE: column layout, npts values of projected dimension j
+  template <typename T> const T *column(uint32_t j) const {
+    return data<T>() + j * header_.npts;
+  }
+
+  template <typename T> T at(uint64_t i, uint32_t j) const {
+    const T *base = data<T>();
+    switch (header_.kind) {
+      case LayoutKind::Row:
+        return base[i * header_.dims + j];
+      case LayoutKind::Blocked: {
+        uint64_t b{header_.blockRows};
+        return base[((i / b) * header_.dims + j) * b + i % b];
+      }
+      case LayoutKind::Column:
+        return base[j * header_.npts + i];
+    }
+    return T{};
+  }
+
+  template <typename T> void gatherRow(uint64_t i, T *out) const {
+    for (uint32_t j{0}; j < header_.dims; ++j) {
+      out[j] = at<T>(i, j);
+    }
+  }
+
+ private:
+  // NOTE: everything the accessors rely on: at() divides by blockRows, the
+  // dim map must end before the data, and a corrupt kind or elem would
+  // index past the dispatch tables
+  void checkHeader(const std::string &path) const {
+    const LayoutHeader &h = header_;
+    bool valid{static_cast<uint8_t>(h.kind) <=
+                   static_cast<uint8_t>(LayoutKind::Column) &&
+               static_cast<std::size_t>(h.elem) < kNumElemTypes};
+    if (valid && h.kind == LayoutKind::Blocked) {
+      valid = h.blockRows > 0 &&
+              h.paddedRows ==
+                  (h.npts + h.blockRows - 1) / h.blockRows * h.blockRows;
+    } else if (valid) {
+      valid = h.blockRows == 0 && h.paddedRows == h.npts;
+    }
+    valid = valid &&
+            sizeof(LayoutHeader) + uint64_t{h.dims} * sizeof(uint32_t) <=
+                h.dataOffset &&
+            h.dataOffset % kLayoutAlign == 0 && h.dataOffset <= file_.size();
+    if (!valid) {
+      throw std::runtime_error(
+          std::format("ERROR(LayoutReader): Broken Header [{}]", path));
+    }
+  }
+
+  template <typename T> void checkElem() const {
+    if (sizeof(T) != elemSize(header_.elem)) {
+      throw std::runtime_error(std::format(
+          "ERROR(LayoutReader): Element Type Mismatch, File Stores [{}]",
+          elemName(header_.elem)));
+    }
+  }
+
+  MappedFile file_;
+  LayoutHeader header_{};
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// NOTE: Read-only mmap of a whole file. Keeps the page cache doing the work so
+// huge datasets are streamed instead of copied into a heap buffer first.
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  explicit MappedFile(const std::string &path) : path_(path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error(
+          std::format("ERROR(MappedFile): Failed Open File [{}]", path));
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error(
+          std::format("ERROR(MappedFile): Failed Stat File [{}]", path));
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ > 0) {
+      void *addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error(
+            std::format("ERROR(MappedFile): Failed Map File [{}]", path));
+      }
+      data_ = static_cast<const char *>(addr);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept
+      : path_(std::move(other.path_)),
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      path_ = std::move(other.path_);
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  ~MappedFile() { unmap(); }
+
+  const char *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  const std::string &path() const { return path_; }
+
+  template <typename T> const T *as(std::size_t offset = 0) const {
+    return reinterpret_cast<const T *>(data_ + offset);
+  }
+
+  void adviseSequential() const { advise(MADV_SEQUENTIAL); }
+  void adviseRandom() const { advise(MADV_RANDOM); }
+  void adviseWillNeed() const { advise(MADV_WILLNEED); }
+
+ private:
+  void advise(int advice) const {
+    if (data_ != nullptr) {
+      ::madvise(const_cast<char *>(data_), size_, advice);
+    }
+  }
+
+  void unmap() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char *>(data_), size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+  std::string path_{};
+  const char *data_{nullptr};
+  std::size_t size_{0};
+};
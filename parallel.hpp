@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline unsigned hardwareThreads() {
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+// NOTE: Split [begin, end) into chunks of `grain` items and hand them out to
+// `threads` workers through an atomic cursor, fn(chunkBegin, chunkEnd, tid).
+// The first exception thrown by a worker is rethrown on the calling thread.
+template <typename F>
+void parallelFor(uint64_t begin, uint64_t end, uint64_t grain, F &&fn,
+                 unsigned threads = hardwareThreads()) {
+  if (begin >= end) {
+    return;
+  }
+  grain = std::max<uint64_t>(1, grain);
+  uint64_t chunks{(end - begin + grain - 1) / grain};
+  threads = static_cast<unsigned>(std::min<uint64_t>(threads, chunks));
+  if (threads <= 1) {
+    for (uint64_t b{begin}; b < end; b += grain) {
+      fn(b, std::min(end, b + grain), 0U);
+    }
+    return;
+  }
+
+  std::atomic<uint64_t> cursor{begin};
+  std::exception_ptr error{nullptr};
+  std::mutex errorMutex;
+  auto worker = [&](unsigned tid) {
+    try {
+      while (true) {
+        uint64_t b{cursor.fetch_add(grain)};
+        if (b >= end) {
+          break;
+        }
+        fn(b, std::min(end, b + grain), tid);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      cursor.store(end);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads);
+  for (unsigned t{0}; t < threads; ++t) {
+    pool.emplace_back(worker, t);
+  }
+  for (auto &t : pool) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// NOTE: list syntax shared by every tool taking ids, dims or k values from
+// the command line: comma separated items, no spaces, no empty items. Ids
+// and dims are single values or inclusive ranges, e.g. "0-9,15".
+
+// NOTE: std::stoull alone takes "-1" (wrapped) and "3x" and throws
+// std::out_of_range past 2^64, so the whole token must be decimal digits and
+// every failure, including a value above max, is a std::invalid_argument
+inline uint64_t parseUnsigned(
+    const std::string &token,
+    uint64_t max = std::numeric_limits<uint64_t>::max()) {
+  if (token.empty() || !std::all_of(token.begin(), token.end(), [](char c) {
+        return c >= '0' && c <= '9';
+      })) {
+    throw std::invalid_argument("ERROR(parseUnsigned): Not An Integer [" +
+                                token + "]");
+  }
+  const std::string outOfRange{std::format(
+      "ERROR(parseUnsigned): [{}] Out Of Range, at most {}", token, max)};
+  uint64_t value{0};
+  try {
+    value = std::stoull(token);
+  } catch (const std::out_of_range &) {
+    throw std::invalid_argument(outOfRange);
+  }
+  if (value > max) {
+    throw std::invalid_argument(outOfRange);
+  }
+  return value;
+}
+
+inline std::vector<std::string> splitList(const std::string &spec) {
+  std::vector<std::string> items{};
+  std::size_t pos{0};
+  while (pos <= spec.size()) {
+    std::size_t comma{std::min(spec.find(',', pos), spec.size())};
+    items.push_back(spec.substr(pos, comma - pos));
+    pos = comma + 1;
+  }
+  return items;
+}
+
+struct IdRange {
+  uint64_t first;
+  uint64_t last;  // inclusive
+};
+
+// NOTE: callers check the ranges against their own bound before expanding
+inline std::vector<IdRange> parseRangeList(const std::string &spec) {
+  std::vector<IdRange> ranges{};
+  for (const std::string &item : splitList(spec)) {
+    std::size_t dash{item.find('-')};
+    IdRange range{};
+    if (dash == std::string::npos) {
+      range.first = range.last = parseUnsigned(item);
+    } else {
+      range.first = parseUnsigned(item.substr(0, dash));
+      range.last = parseUnsigned(item.substr(dash + 1));
+    }
+    if (range.first > range.last) {
+      throw std::runtime_error("ERROR(parseRangeList): Descending Range [" +
+                               item + "]");
+    }
+    ranges.push_back(range);
+  }
+  return ranges;
+}
+
+inline std::vector<uint32_t> parseKList(const std::string &spec) {
+  std::vector<uint32_t> ks{};
+  for (const std::string &item : splitList(spec)) {
+    uint64_t k{parseUnsigned(item, std::numeric_limits<uint32_t>::max())};
+    if (k == 0) {
+      throw std::runtime_error("ERROR(parseKList): k must be positive [" +
+                               item + "]");
+    }
+    ks.push_back(static_cast<uint32_t>(k));
+  }
+  return ks;
+}
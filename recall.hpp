@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mappedFile.hpp"
+
+// NOTE: Recall math and the mapped result / GT view shared by
+// ./compute_recall_std and ./vtdaemon
+inline double calculateSingleRecall(const uint32_t *gtIDs,
+                                    const float *gtDists, uint32_t gtDims,
+                                    const uint32_t *resIDs, uint32_t resDims,
+                                    uint32_t topK) {
+  // NOTE: sorted + deduplicated small vectors instead of std::set, same
+  // result without a node allocation per id
+  thread_local std::vector<uint32_t> gt, res;
+
+  //  NOTE: Include all ground truth neighbors tied at the topK distance.
+  uint32_t gtTieBreaker = topK;
+  if (gtDists != nullptr) {
+    gtTieBreaker = topK - 1;
+    while (gtTieBreaker < gtDims &&
+           gtDists[gtTieBreaker] == gtDists[topK - 1]) {
+      ++gtTieBreaker;
+    }
+  }
+
+  gt.assign(gtIDs, gtIDs + gtTieBreaker);
+  res.assign(resIDs, resIDs + topK);
+  std::sort(gt.begin(), gt.end());
+  std::sort(res.begin(), res.end());
+  gt.erase(std::unique(gt.begin(), gt.end()), gt.end());
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+
+  unsigned curRecall = 0;
+  auto g = gt.begin();
+  for (auto id : res) {
+    g = std::lower_bound(g, gt.end(), id);
+    if (g != gt.end() && *g == id) {
+      ++curRecall;
+    }
+  }
+
+  return static_cast<double>(curRecall) / topK;
+}
+
+inline double calculateTotalRecall(uint32_t numQueries,
+                                   const uint32_t *gtIDs, const float *gtDists,
+                                   uint32_t gtDims, const uint32_t *resIDs,
+                                   uint32_t resDims, uint32_t topK) {
+  double totalRecall = 0;
+  for (unsigned q{0}; q < numQueries; ++q) {
+    const uint32_t *gtVec = gtIDs + q * gtDims;
+    const uint32_t *resVec = resIDs + q * resDims;
+    const float *gtDistVec =
+        gtDists == nullptr ? nullptr : gtDists + q * gtDims;
+
+    totalRecall +=
+        calculateSingleRecall(gtVec, gtDistVec, gtDims, resVec, resDims, topK);
+  }
+  return totalRecall / numQueries;
+}
+
+inline std::vector<double> calculateRecallPerQuery(
+    uint32_t numQueries, const uint32_t *gtIDs, const float *gtDists,
+    uint32_t gtDims, const uint32_t *resIDs, uint32_t resDims, uint32_t topK) {
+  std::vector<double> recallList(numQueries);
+  for (unsigned q{0}; q < numQueries; ++q) {
+    const uint32_t *gtVec = gtIDs + q * gtDims;
+    const uint32_t *resVec = resIDs + q * resDims;
+    const float *gtDistVec =
+        gtDists == nullptr ? nullptr : gtDists + q * gtDims;
+
+    recallList.at(q) =
+        calculateSingleRecall(gtVec, gtDistVec, gtDims, resVec, resDims, topK);
+  }
+  return recallList;
+}
+
+inline double computeRecallSTD(const std::vector<double> &recallLists) {
+  unsigned numQueries = recallLists.size();
+  double mean =
+      std::accumulate(recallLists.begin(), recallLists.end(), 0.0) / numQueries;
+  double varience = 0;
+  for (auto recall : recallLists) {
+    varience += std::pow((recall - mean), 2);
+  }
+  varience /= numQueries;
+  return std::sqrt(varience);
+}
+
+inline double computeRecallAvg(const std::vector<double> &recallLists) {
+  if (recallLists.empty()) {
+    return 0;
+  }
+  double sum = std::accumulate(recallLists.begin(), recallLists.end(), 0.0);
+  return sum / recallLists.size();
+}
+
+// NOTE: ids (and distances when the file carries them) of a result / GT bin
+// file, read straight out of the mapping
+struct ResultView {
+  MappedFile file;
+  uint32_t npts{0};
+  uint32_t dims{0};
+  const uint32_t *ids{nullptr};
+  const float *dists{nullptr};
+};
+
+inline ResultView mapResultBin(const std::string &path) {
+  ResultView view{MappedFile(path)};
+  const MappedFile &file = view.file;
+  if (file.size() < 2 * sizeof(uint32_t)) {
+    throw std::runtime_error(
+        std::format("ERROR(mapResultBin): File Too Small [{}]", path));
+  }
+  view.npts = file.as<uint32_t>()[0];
+  view.dims = file.as<uint32_t>()[1];
+  uint64_t idsBytes{uint64_t{view.npts} * view.dims * sizeof(uint32_t)};
+  view.ids = file.as<uint32_t>(2 * sizeof(uint32_t));
+  if (file.size() == 2 * sizeof(uint32_t) + 2 * idsBytes) {
+    view.dists = file.as<float>(2 * sizeof(uint32_t) + idsBytes);
+  } else if (file.size() != 2 * sizeof(uint32_t) + idsBytes) {
+    throw std::runtime_error(std::format(
+        "ERROR(mapResultBin): File size mismatch for [{}], npts[{}], dims[{}]",
+        path, view.npts, view.dims));
+  }
+  return view;
+}
@@ -0,0 +1,166 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "checksum.hpp"
+#include "fileIO.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+
+// NOTE: each worker remaps this many ids before issuing one pwrite
+constexpr uint64_t kGrainIds = 1UL << 20;
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+// NOTE: Rewrite every id of a GT / result bin file through a permutation
+// (bin file of npts x 1 uint32, old id -> new id as saved by ./reorderData).
+// Both [npts][dims][ids] and [npts][dims][ids][dists] layouts are accepted,
+// distances are copied through untouched. UINT32_MAX (padding for queries
+// with fewer than dims neighbors) is kept as it is, any other id outside the
+// permutation fails the job, it would silently point at an unrelated row.
+void remapIds(const std::string &inputPath, const std::string &permutationPath,
+              const std::string &outputPath, unsigned threads) {
+  MappedFile input(inputPath);
+  MappedFile permutation(permutationPath);
+  input.adviseSequential();
+  permutation.adviseRandom();
+
+  if (input.size() < 2 * sizeof(uint32_t) ||
+      permutation.size() < 2 * sizeof(uint32_t)) {
+    throw std::runtime_error("ERROR(remapIds): File Too Small");
+  }
+  const uint32_t *inHeader = input.as<uint32_t>();
+  const uint32_t *permHeader = permutation.as<uint32_t>();
+  uint64_t npts{inHeader[0]}, dims{inHeader[1]};
+  uint64_t permSize{permHeader[0]};
+  uint64_t idsBytes{npts * dims * sizeof(uint32_t)};
+
+  uint64_t permBytes{2 * sizeof(uint32_t) + permSize * sizeof(uint32_t)};
+  if (permHeader[1] != 1 || permutation.size() != permBytes) {
+    throw std::runtime_error(std::format(
+        "ERROR(remapIds): [{}] is not a npts x 1 uint32 bin file",
+        permutationPath));
+  }
+  bool hasDists{input.size() == 2 * sizeof(uint32_t) + 2 * idsBytes};
+  if (!hasDists && input.size() != 2 * sizeof(uint32_t) + idsBytes) {
+    throw std::runtime_error(std::format(
+        "ERROR(remapIds): File size mismatch for [{}], npts[{}], dims[{}]",
+        inputPath, npts, dims));
+  }
+  std::cout << std::format("Remap npts[{}], dims[{}]{} through [{}] ({} ids)",
+                           npts, dims, hasDists ? " with dists" : "",
+                           permutationPath, permSize)
+            << std::endl;
+
+  StagedTarget staged(outputPath, {inputPath, permutationPath});
+  int fd = ::open(staged.path().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error(
+        std::format("ERROR(remapIds): Failed Open File [{}]", outputPath));
+  }
+  if (::ftruncate(fd, input.size()) != 0) {
+    ::close(fd);
+    throw std::runtime_error("ERROR(remapIds): Failed Resize Target File");
+  }
+
+  const uint32_t *ids = input.as<uint32_t>(2 * sizeof(uint32_t));
+  const uint32_t *perm = permutation.as<uint32_t>(2 * sizeof(uint32_t));
+  std::atomic<uint64_t> outOfRange{0};
+  try {
+    writeAt(fd, input.data(), 2 * sizeof(uint32_t), 0);
+    parallelFor(
+        0, npts * dims, kGrainIds,
+        [&](uint64_t begin, uint64_t end, unsigned) {
+          std::unique_ptr<uint32_t[]> buf =
+              std::make_unique<uint32_t[]>(end - begin);
+          uint64_t invalid{0};
+          for (uint64_t i{begin}; i < end; ++i) {
+            uint32_t id{ids[i]};
+            if (id < permSize) {
+              buf[i - begin] = perm[id];
+            } else {
+              buf[i - begin] = id;
+              invalid += id != UINT32_MAX;
+            }
+          }
+          outOfRange += invalid;
+          writeAt(fd, reinterpret_cast<const char *>(buf.get()),
+                  (end - begin) * sizeof(uint32_t),
+                  2 * sizeof(uint32_t) + begin * sizeof(uint32_t));
+        },
+        threads);
+    if (hasDists) {
+      uint64_t offset{2 * sizeof(uint32_t) + idsBytes};
+      writeAt(fd, input.data() + offset, idsBytes, offset);
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+
+  if (outOfRange > 0) {
+    if (staged.path() == outputPath) {
+      std::filesystem::remove(outputPath);
+    }
+    throw std::runtime_error(std::format(
+        "ERROR(remapIds): {} ids of [{}] are outside the permutation of {} "
+        "ids, wrong permutation file?",
+        outOfRange.load(), inputPath, permSize));
+  }
+  staged.commit();
+}
+
+int main(int argc, char **argv) {
+  if (argc != 4 && argc != 5) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./remapIds [gt/result bin path] "
+                 "[permutation bin path] [output bin path] "
+                 "[threads(optional)]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string inputPath{argv[1]};
+  std::string permutationPath{argv[2]};
+  std::string outputPath{argv[3]};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(inputPath);
+    checkFileExists(permutationPath);
+    checkSidecar(inputPath);
+    checkSidecar(permutationPath);
+    if (argc == 5) {
+      threads = std::stoi(argv[4]);
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [threads] Argument must be an integer." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  try {
+    remapIds(inputPath, permutationPath, outputPath, threads);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Remap Done!" << std::endl;
+}
@@ -6,8 +6,11 @@
 #include <memory>
 #include <random> // std::mt19937
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "checksum.hpp"
+
 void loadMetaInfo(const std::filesystem::path &sourcePath, unsigned &npts,
                   unsigned &dims);
 
@@ -25,10 +28,14 @@ void saveDestinationFile(const std::filesystem::path &destinationPath,
                          const std::unique_ptr<float[]> data,
                          const unsigned &npts, const unsigned &dims);
 
+void savePermutation(const std::filesystem::path &permutationPath,
+                     const std::vector<unsigned> &ids);
+
 int main(int argc, char **argv) {
-  if (argc != 3) {
+  if (argc != 3 && argc != 5) {
     std::cerr << "Error Usage, Please Follow Usage!" << std::endl;
-    std::cout << "./reorderData [source DataPath] [destination DataPath]"
+    std::cout << "./reorderData [source DataPath] [destination DataPath] "
+                 "[--seed N(optional)]"
               << std::endl;
     return -1;
   }
@@ -37,28 +44,66 @@ int main(int argc, char **argv) {
   std::filesystem::path destinationPath{argv[2]};
   unsigned npts{0}, dims{0};
 
+  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+  if (argc == 5) {
+    if (std::string(argv[3]) != "--seed") {
+      std::cerr << "Error Usage, Unknown Option: " << argv[3] << std::endl;
+      return -1;
+    }
+    try {
+      seed = std::stoul(argv[4]);
+    } catch (const std::exception &e) {
+      std::cerr << "Error: --seed must be an unsigned integer." << std::endl;
+      return -1;
+    }
+  }
+  std::cout << "Shuffle Seed: " << seed << std::endl;
+
   try {
+    checkSidecar(sourcePath.string());
     loadMetaInfo(sourcePath, npts, dims);
     checkFileSize(sourcePath, npts, dims);
   } catch (const std::exception &e) {
     std::cerr << "Runtime_ERROR: " << e.what() << std::endl;
+    return -1;
   }
 
   std::vector<unsigned> ids(npts);
   std::iota(ids.begin(), ids.end(), 0);
 
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
   std::mt19937 engine(seed);
   std::shuffle(ids.begin(), ids.end(), engine);
 
+  // NOTE: row i of the source is written to row ids[i] of the destination.
+  // Keep both directions so existing ground truth can be remapped with
+  // ./remapIds instead of being recomputed.
+  std::vector<unsigned> inverseIds(npts);
+  for (unsigned i{0}; i < npts; ++i) {
+    inverseIds[ids[i]] = i;
+  }
+
   try {
     std::unique_ptr<float[]> originalData = loadMainData(sourcePath);
     std::unique_ptr<float[]> data =
         reorderData(std::move(originalData), ids, npts, dims);
     saveDestinationFile(destinationPath, std::move(data), npts, dims);
     checkFileSize(destinationPath, npts, dims);
+
+    // NOTE: written only once the reordered data is complete, so a failed or
+    // interrupted run never leaves a permutation without its data
+    std::filesystem::path permutationPath{destinationPath};
+    std::filesystem::path inversePath{destinationPath};
+    permutationPath += ".perm.bin";
+    inversePath += ".iperm.bin";
+    savePermutation(permutationPath, ids);
+    savePermutation(inversePath, inverseIds);
+    std::cout << "Save Permutation (old id -> new id) Into "
+              << permutationPath.string() << std::endl;
+    std::cout << "Save Inverse Permutation (new id -> old id) Into "
+              << inversePath.string() << std::endl;
   } catch (const std::exception &e) {
     std::cerr << "Runtime_ERROR: " << e.what() << std::endl;
+    return -1;
   }
 
   return 0;
@@ -136,3 +181,18 @@ void saveDestinationFile(const std::filesystem::path &destinationPath,
   writer.write((char *)&dims, sizeof(unsigned));
   writer.write((char *)data.get(), writeLen);
 }
+
+void savePermutation(const std::filesystem::path &permutationPath,
+                     const std::vector<unsigned> &ids) {
+  std::ofstream writer(permutationPath, std::ios::binary);
+  if (!writer.is_open()) {
+    throw std::runtime_error("Failed to open file: " +
+                             permutationPath.string());
+  }
+  // NOTE: stored as a bin file of npts x 1 uint32
+  unsigned npts = ids.size();
+  unsigned dims = 1;
+  writer.write((char *)&npts, sizeof(unsigned));
+  writer.write((char *)&dims, sizeof(unsigned));
+  writer.write((char *)ids.data(), npts * sizeof(unsigned));
+}
@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "denseFile.hpp"
+#include "formatTraits.hpp"
+#include "parallel.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// NOTE: bytes of source rows (as f32) read per streamed chunk
+constexpr uint64_t kChunkBytes = 64UL << 20;
+// NOTE: hyperplanes per packed strip, two AVX2 registers of accumulators
+constexpr uint32_t kStripPlanes = 16;
+// NOTE: rows per work item, a tile stays in L2 while every strip passes it
+constexpr uint64_t kRowTile = 64;
+
+enum class Projection { Gaussian, Sparse };
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+// NOTE: bit j of a code is sign(w_j . x + b_j), stored LSB first at byte
+// j / 8. planes/bias are what gets saved to <target>.proj.bin, strips is
+// the same matrix packed for the kernel: strip g holds planes
+// [16g, 16g + 16) as dims x 16 floats, zero padded past the last plane.
+struct SketchModel {
+  uint32_t bits{0};
+  uint32_t dims{0};
+  std::vector<float> planes{};
+  std::vector<float> bias{};
+  std::vector<float> strips{};
+  std::vector<float> stripBias{};
+
+  uint32_t codeBytes() const { return bits / 8; }
+  uint32_t numStrips() const {
+    return (bits + kStripPlanes - 1) / kStripPlanes;
+  }
+
+  void pack() {
+    strips.assign(uint64_t{numStrips()} * dims * kStripPlanes, 0.0f);
+    stripBias.assign(uint64_t{numStrips()} * kStripPlanes, 0.0f);
+    for (uint32_t j{0}; j < bits; ++j) {
+      float *strip = strips.data() + uint64_t{j / kStripPlanes} * dims *
+                                         kStripPlanes;
+      for (uint32_t d{0}; d < dims; ++d) {
+        strip[d * kStripPlanes + j % kStripPlanes] =
+            planes[uint64_t{j} * dims + d];
+      }
+      stripBias[j] = bias[j];
+    }
+  }
+};
+
+// NOTE: mt19937_64 is fully specified by the standard but the std
+// distributions are not, so the planes are drawn by hand to keep a seed
+// producing the same sketch with every standard library.
+double uniform01(std::mt19937_64 &engine) {
+  return (engine() >> 11) * 0x1.0p-53;
+}
+
+SketchModel randomModel(uint32_t bits, uint32_t dims, Projection projection,
+                        uint64_t seed) {
+  SketchModel model{bits, dims};
+  model.planes.resize(uint64_t{bits} * dims);
+  model.bias.assign(bits, 0.0f);
+  std::mt19937_64 engine(seed);
+  if (projection == Projection::Gaussian) {
+    // NOTE: Box-Muller, SimHash hyperplanes with N(0, 1) normals
+    for (uint64_t i{0}; i < model.planes.size(); i += 2) {
+      double r{std::sqrt(-2.0 * std::log(1.0 - uniform01(engine)))};
+      double theta{2.0 * std::numbers::pi * uniform01(engine)};
+      model.planes[i] = r * std::cos(theta);
+      if (i + 1 < model.planes.size()) {
+        model.planes[i + 1] = r * std::sin(theta);
+      }
+    }
+  } else {
+    // NOTE: Achlioptas sparse projection, +1 / -1 with probability 1/6
+    // each and 0 otherwise; the sqrt(3) scale does not change the sign
+    for (float &w : model.planes) {
+      double u{uniform01(engine)};
+      w = u < 1.0 / 6 ? 1.0f : (u < 2.0 / 6 ? -1.0f : 0.0f);
+    }
+  }
+  return model;
+}
+
+// NOTE: projection file, an f32 bin with one row [w_0 .. w_{dims-1}, b] per
+// bit, so query sketches can reuse exactly the base projection
+void saveModel(const std::string &path, const SketchModel &model) {
+  std::ofstream writer(path, std::ios::binary);
+  if (!writer.is_open()) {
+    throw std::runtime_error("ERROR(saveModel): Failed Open File " + path);
+  }
+  uint32_t header[2]{model.bits, model.dims + 1};
+  writer.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for (uint32_t j{0}; j < model.bits; ++j) {
+    writer.write(
+        reinterpret_cast<const char *>(model.planes.data() +
+                                       uint64_t{j} * model.dims),
+        model.dims * sizeof(float));
+    writer.write(reinterpret_cast<const char *>(&model.bias[j]),
+                 sizeof(float));
+  }
+}
+
+SketchModel loadModel(const std::string &path) {
+  checkFileExists(path);
+  DenseFile file{inspectDenseFile(path, Format{Container::Bin},
+                                  ElemType::F32)};
+  if (file.dims < 2 || file.npts % 8 != 0) {
+    throw std::runtime_error(
+        std::format("ERROR(loadModel): [{}] is not a projection file", path));
+  }
+  std::vector<float> rows{loadRows(file, 0, file.npts)};
+  SketchModel model{static_cast<uint32_t>(file.npts), file.dims - 1};
+  model.planes.resize(uint64_t{model.bits} * model.dims);
+  model.bias.resize(model.bits);
+  for (uint32_t j{0}; j < model.bits; ++j) {
+    const float *row = rows.data() + uint64_t{j} * file.dims;
+    std::copy(row, row + model.dims,
+              model.planes.data() + uint64_t{j} * model.dims);
+    model.bias[j] = row[model.dims];
+  }
+  return model;
+}
+
+// NOTE: sign bits of the 16 planes of one strip for 4 rows, written to
+// byte `byte` (and byte + 1 when the code has it) of every row's code
+inline void projectStrip4(const float *const x[4], const float *strip,
+                          const float *bias, uint32_t dims, uint32_t byte,
+                          uint32_t codeBytes, uint8_t *const code[4]) {
+  uint16_t bits[4]{};
+#if defined(__AVX2__) && defined(__FMA__)
+  __m256 acc[4][2];
+  for (auto &row : acc) {
+    row[0] = _mm256_loadu_ps(bias);
+    row[1] = _mm256_loadu_ps(bias + 8);
+  }
+  for (uint32_t d{0}; d < dims; ++d) {
+    __m256 p0 = _mm256_loadu_ps(strip + d * kStripPlanes);
+    __m256 p1 = _mm256_loadu_ps(strip + d * kStripPlanes + 8);
+    for (int r{0}; r < 4; ++r) {
+      __m256 xv = _mm256_broadcast_ss(x[r] + d);
+      acc[r][0] = _mm256_fmadd_ps(xv, p0, acc[r][0]);
+      acc[r][1] = _mm256_fmadd_ps(xv, p1, acc[r][1]);
+    }
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  for (int r{0}; r < 4; ++r) {
+    int lo{_mm256_movemask_ps(_mm256_cmp_ps(acc[r][0], zero, _CMP_GT_OQ))};
+    int hi{_mm256_movemask_ps(_mm256_cmp_ps(acc[r][1], zero, _CMP_GT_OQ))};
+    bits[r] = static_cast<uint16_t>(lo | hi << 8);
+  }
+#else
+  for (int r{0}; r < 4; ++r) {
+    for (uint32_t p{0}; p < kStripPlanes; ++p) {
+      float sum{bias[p]};
+      for (uint32_t d{0}; d < dims; ++d) {
+        sum += x[r][d] * strip[d * kStripPlanes + p];
+      }
+      bits[r] |= static_cast<uint16_t>(sum > 0) << p;
+    }
+  }
+#endif
+  for (int r{0}; r < 4; ++r) {
+    if (code[r] == nullptr) {
+      continue;
+    }
+    code[r][byte] = static_cast<uint8_t>(bits[r]);
+    if (byte + 1 < codeBytes) {
+      code[r][byte + 1] = static_cast<uint8_t>(bits[r] >> 8);
+    }
+  }
+}
+
+// NOTE: codes of rows [begin, end), blocked as row tile x plane strip x 4
+// rows so each strip is reused by the whole tile while it is hot
+void projectRows(const SketchModel &model, const float *rows, uint64_t begin,
+                 uint64_t end, uint8_t *codes) {
+  const uint32_t dims{model.dims};
+  const uint32_t codeBytes{model.codeBytes()};
+  for (uint64_t tb{begin}; tb < end; tb += kRowTile) {
+    uint64_t te{std::min(end, tb + kRowTile)};
+    for (uint32_t g{0}; g < model.numStrips(); ++g) {
+      const float *strip = model.strips.data() +
+                           uint64_t{g} * dims * kStripPlanes;
+      const float *bias = model.stripBias.data() + g * kStripPlanes;
+      for (uint64_t r0{tb}; r0 < te; r0 += 4) {
+        const float *x[4];
+        uint8_t *code[4];
+        for (uint64_t r{0}; r < 4; ++r) {
+          bool valid{r0 + r < te};
+          x[r] = rows + (valid ? r0 + r : te - 1) * dims;
+          code[r] = valid ? codes + (r0 + r) * codeBytes : nullptr;
+        }
+        projectStrip4(x, strip, bias, dims, g * kStripPlanes / 8, codeBytes,
+                      code);
+      }
+    }
+  }
+}
+
+// NOTE: first pass for --center, the per-dimension mean of the source
+std::vector<double> columnMean(const DenseFile &source, uint64_t chunkRows,
+                               unsigned threads) {
+  std::vector<double> mean(source.dims, 0.0);
+  std::vector<std::vector<double>> partial(
+      threads, std::vector<double>(source.dims, 0.0));
+  for (uint64_t first{0}; first < source.npts; first += chunkRows) {
+    uint64_t last{std::min(source.npts, first + chunkRows)};
+    std::vector<float> rows{loadRows(source, first, last)};
+    parallelFor(
+        0, last - first, kRowTile,
+        [&](uint64_t begin, uint64_t end, unsigned tid) {
+          for (uint64_t i{begin}; i < end; ++i) {
+            for (uint32_t d{0}; d < source.dims; ++d) {
+              partial[tid][d] += rows[i * source.dims + d];
+            }
+          }
+        },
+        threads);
+  }
+  for (const auto &sum : partial) {
+    for (uint32_t d{0}; d < source.dims; ++d) {
+      mean[d] += sum[d];
+    }
+  }
+  for (double &m : mean) {
+    m /= std::max<uint64_t>(1, source.npts);
+  }
+  return mean;
+}
+
+// NOTE: hyperplanes through the data mean instead of the origin, b = -w.mu
+void centerModel(SketchModel &model, const std::vector<double> &mean) {
+  for (uint32_t j{0}; j < model.bits; ++j) {
+    double dot{0};
+    for (uint32_t d{0}; d < model.dims; ++d) {
+      dot += model.planes[uint64_t{j} * model.dims + d] * mean[d];
+    }
+    model.bias[j] = -dot;
+  }
+}
+
+// NOTE: Streams the source in kChunkBytes chunks (the next one is read in
+// the background), projects each chunk in parallel and appends the codes.
+// The output is a u8bin file: [npts][code bytes][npts x code bytes].
+void writeSketch(const DenseFile &source, const SketchModel &model,
+                 const std::string &targetPath, uint64_t chunkRows,
+                 unsigned threads) {
+  std::ofstream writer(targetPath, std::ios::binary);
+  if (!writer.is_open()) {
+    throw std::runtime_error("ERROR(writeSketch): Failed Open File " +
+                             targetPath);
+  }
+  uint32_t header[2]{static_cast<uint32_t>(source.npts), model.codeBytes()};
+  writer.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+  auto loadChunk = [&](uint64_t first) {
+    return loadRows(source, first, std::min(source.npts, first + chunkRows));
+  };
+  std::future<std::vector<float>> pending{};
+  if (source.npts > 0) {
+    pending = std::async(std::launch::async, loadChunk, 0);
+  }
+  std::vector<uint8_t> codes{};
+  for (uint64_t first{0}; first < source.npts; first += chunkRows) {
+    std::vector<float> rows{pending.get()};
+    if (first + chunkRows < source.npts) {
+      pending = std::async(std::launch::async, loadChunk, first + chunkRows);
+    }
+    uint64_t count{std::min(chunkRows, source.npts - first)};
+    codes.resize(count * model.codeBytes());
+    parallelFor(
+        0, count, kRowTile,
+        [&](uint64_t begin, uint64_t end, unsigned) {
+          projectRows(model, rows.data(), begin, end, codes.data());
+        },
+        threads);
+    writer.write(reinterpret_cast<const char *>(codes.data()), codes.size());
+    std::cout << std::format("Sketched rows [{}, {}) of {}", first,
+                             first + count, source.npts)
+              << std::endl;
+  }
+  writer.flush();
+  if (!writer) {
+    throw std::runtime_error("ERROR(writeSketch): Failed Write File " +
+                             targetPath);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 5 || argc % 2 == 0) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./sketch [source path] [source format] [target path] "
+                 "[bits, multiple of 8] [--method gaussian|sparse] "
+                 "[--seed N] [--center on|off] [--proj projection path] "
+                 "[--type data type] [--threads N]"
+              << std::endl;
+    std::cout << "       Writes u8bin codes and <target>.proj.bin, pass that "
+                 "as --proj when sketching queries for the same base"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string sourcePath{argv[1]};
+  std::string formatName{argv[2]};
+  std::string targetPath{argv[3]};
+  std::string dataType{"f32"};
+  std::string methodName{"gaussian"};
+  std::string projPath{};
+  bool center{false};
+  bool randomOptions{false};
+  uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+  uint32_t bits{0};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(sourcePath);
+    checkSidecar(sourcePath);
+    bits = std::stoul(argv[4]);
+    for (int i{5}; i + 1 < argc; i += 2) {
+      std::string option{argv[i]};
+      std::string value{argv[i + 1]};
+      if (option == "--method") {
+        methodName = value;
+        randomOptions = true;
+      } else if (option == "--seed") {
+        seed = std::stoull(value);
+        randomOptions = true;
+      } else if (option == "--center") {
+        if (value != "on" && value != "off") {
+          throw std::runtime_error("--center takes on or off");
+        }
+        center = value == "on";
+        randomOptions = true;
+      } else if (option == "--proj") {
+        projPath = value;
+      } else if (option == "--type") {
+        dataType = value;
+      } else if (option == "--threads") {
+        threads = std::max(1, std::stoi(value));
+      } else {
+        throw std::runtime_error("Unknown Option: " + option);
+      }
+    }
+    if (!projPath.empty() && randomOptions) {
+      throw std::runtime_error(
+          "--proj reuses a saved projection, it cannot be combined with "
+          "--method, --seed or --center");
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [bits], [--seed] and [--threads] must be integers."
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::optional<Format> format{parseFormat(formatName)};
+  std::optional<ElemType> elem{parseElemType(dataType)};
+  if (!format || !elem || bits == 0 || bits % 8 != 0 ||
+      (methodName != "gaussian" && methodName != "sparse")) {
+    std::cerr << "ERROR: Input format, data type, bits or method does not "
+                 "meet requirements"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  try {
+    DenseFile source{
+        inspectDenseFile(sourcePath, *format, format->elem.value_or(*elem))};
+    if (source.npts > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error(
+          "u8bin npts is uint32, source has too many rows");
+    }
+    const uint64_t chunkRows{std::max<uint64_t>(
+        kRowTile, kChunkBytes / (uint64_t{source.dims} * sizeof(float)))};
+
+    SketchModel model{};
+    if (!projPath.empty()) {
+      model = loadModel(projPath);
+      std::cout << "Load Projection From " << projPath << std::endl;
+      if (model.bits != bits || model.dims != source.dims) {
+        throw std::runtime_error(std::format(
+            "Projection is {} bits x {} dims, expected {} bits x {} dims",
+            model.bits, model.dims, bits, source.dims));
+      }
+    } else {
+      std::cout << std::format("Projection: {}, Seed: {}, Center: {}",
+                               methodName, seed, center ? "on" : "off")
+                << std::endl;
+      model = randomModel(bits, source.dims,
+                          methodName == "gaussian" ? Projection::Gaussian
+                                                   : Projection::Sparse,
+                          seed);
+      if (center) {
+        centerModel(model, columnMean(source, chunkRows, threads));
+      }
+      std::string modelPath{targetPath + ".proj.bin"};
+      saveModel(modelPath, model);
+      std::cout << "Save Projection Into " << modelPath << std::endl;
+    }
+    model.pack();
+
+    std::cout << std::format("Source: npts[{}], dims[{}], {}; Sketch: "
+                             "{} bits ({} bytes per code)",
+                             source.npts, source.dims, elemName(source.elem),
+                             model.bits, model.codeBytes())
+              << std::endl;
+    writeSketch(source, model, targetPath, chunkRows, threads);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Sketch Done!" << std::endl;
+}
@@ -1,12 +1,21 @@
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <ios>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include "checksum.hpp"
+#include "sparseFile.hpp"
 
 void checkFileExists(const std::string &path) {
   if (!std::filesystem::exists(path)) {
@@ -105,11 +114,59 @@ void writeVec(const std::string &path, const std::unique_ptr<char[]> data,
   writer.close();
 }
 
+// NOTE: Prefix (no seed) or uniformly sampled (seed) rows of a csr file. The
+// sampled row ids are kept in order and saved as <target>.ids.bin (npts x 1
+// uint32) so ground truth and results can be mapped back to the source.
+void sliceSparse(const std::string &sourcePath, const std::string &targetPath,
+                 unsigned size, std::optional<unsigned> seed) {
+  SparseMatrix source(sourcePath);
+  unsigned ss{getCutSize(size, source.nrow())};
+
+  std::vector<uint32_t> rows(ss);
+  if (seed) {
+    std::vector<uint32_t> all(source.nrow());
+    std::iota(all.begin(), all.end(), 0);
+    std::mt19937 engine(*seed);
+    for (unsigned i{0}; i < ss; ++i) {
+      std::uniform_int_distribution<uint64_t> pick(i, all.size() - 1);
+      std::swap(all[i], all[pick(engine)]);
+    }
+    std::copy(all.begin(), all.begin() + ss, rows.begin());
+    std::sort(rows.begin(), rows.end());
+  } else {
+    std::iota(rows.begin(), rows.end(), 0);
+  }
+
+  std::vector<int64_t> indptr(ss + 1, 0);
+  for (unsigned i{0}; i < ss; ++i) {
+    indptr[i + 1] = indptr[i] + source.row(rows[i]).nnz;
+  }
+  SparseWriter writer(targetPath, source.ncol(), std::move(indptr));
+  if (!seed) {
+    writer.writeRows(0, ss, source.indices(), source.values());
+  } else {
+    for (unsigned i{0}; i < ss; ++i) {
+      SparseRow row{source.row(rows[i])};
+      writer.writeRows(i, i + 1, row.indices, row.values);
+    }
+    std::fstream ids = openBinaryFile(targetPath + ".ids.bin", std::ios::out);
+    unsigned dims{1};
+    ids.write(reinterpret_cast<const char *>(&ss), sizeof(unsigned));
+    ids.write(reinterpret_cast<const char *>(&dims), sizeof(unsigned));
+    ids.write(reinterpret_cast<const char *>(rows.data()),
+              sizeof(uint32_t) * ss);
+  }
+  std::cout << std::format("Write {} rows, {} non-zeros into {}", ss,
+                           writer.indptr().back(), targetPath)
+            << std::endl;
+}
+
 int main(int argc, char **argv) {
-  if (argc != 6) {
+  if (argc != 6 && argc != 7) {
     std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
     std::cout << "Usage: ./slice [source dataset path] [source dataset format] "
-                 "[target dataset path] [target dataset format] [size]"
+                 "[target dataset path] [target dataset format] [size] "
+                 "[sample seed(optional, csr only)]"
               << std::endl;
 
     exit(EXIT_FAILURE);
@@ -124,15 +181,26 @@ int main(int argc, char **argv) {
   try {
     sourcePath = argv[1];
     checkFileExists(sourcePath);
+    checkSidecar(sourcePath);
   } catch (const std::runtime_error &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     exit(EXIT_FAILURE);
   }
 
+  std::optional<unsigned> seed{};
   try {
     counts = std::stoi(argv[5]);
+    if (argc == 7) {
+      seed = std::stoul(argv[6]);
+    }
   } catch (const std::invalid_argument &e) {
-    std::cerr << "Error: Size Argument must be an integer." << std::endl;
+    std::cerr << "Error: Size and Seed Argument must be an integer."
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (seed && sourceFormat != std::string("csr")) {
+    std::cerr << "ERROR: Sampled slicing only supports [csr] format"
+              << std::endl;
     exit(EXIT_FAILURE);
   }
 
@@ -152,6 +220,13 @@ int main(int argc, char **argv) {
                              counts * (dims * sizeof(float) + sizeof(unsigned)),
                              targetPath)
               << std::endl;
+  } else if (sourceFormat == std::string("csr")) {
+    try {
+      sliceSparse(sourcePath, targetPath, counts, seed);
+    } catch (const std::runtime_error &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      exit(EXIT_FAILURE);
+    }
   } else {
     std::cerr << "ERROR: Input format does not meet requirements" << std::endl;
     exit(EXIT_FAILURE);
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fileIO.hpp"
+#include "mappedFile.hpp"
+
+// NOTE: CSR sparse vector file, the layout used by the NeurIPS'23 sparse
+// track (SPLADE embeddings):
+//   [nrow(i64)][ncol(i64)][nnz(i64)]
+//   [indptr: (nrow + 1) x i64][indices: nnz x i32][values: nnz x f32]
+// Row i owns indices/values [indptr[i], indptr[i + 1]).
+constexpr uint64_t kCsrHeaderBytes = 3 * sizeof(int64_t);
+
+inline uint64_t csrIndicesOffset(uint64_t nrow) {
+  return kCsrHeaderBytes + (nrow + 1) * sizeof(int64_t);
+}
+
+inline uint64_t csrValuesOffset(uint64_t nrow, uint64_t nnz) {
+  return csrIndicesOffset(nrow) + nnz * sizeof(int32_t);
+}
+
+inline uint64_t csrFileBytes(uint64_t nrow, uint64_t nnz) {
+  return csrValuesOffset(nrow, nnz) + nnz * sizeof(float);
+}
+
+struct SparseRow {
+  const int32_t *indices;
+  const float *values;
+  uint64_t nnz;
+};
+
+// NOTE: mmap backed, zero-copy view of a CSR file
+class SparseMatrix {
+ public:
+  explicit SparseMatrix(const std::string &path) : file_(path) {
+    if (file_.size() < kCsrHeaderBytes) {
+      throw std::runtime_error(
+          std::format("ERROR(SparseMatrix): File Too Small [{}]", path));
+    }
+    const int64_t *header = file_.as<int64_t>();
+    if (header[0] < 0 || header[1] < 0 || header[2] < 0) {
+      throw std::runtime_error(
+          std::format("ERROR(SparseMatrix): Broken Header [{}]", path));
+    }
+    nrow_ = header[0];
+    ncol_ = header[1];
+    nnz_ = header[2];
+    if (file_.size() != csrFileBytes(nrow_, nnz_)) {
+      throw std::runtime_error(std::format(
+          "ERROR(SparseMatrix): File size mismatch: Expected {} bytes, but "
+          "got {} bytes for file: {}",
+          csrFileBytes(nrow_, nnz_), file_.size(), path));
+    }
+    // NOTE: one pass over indptr, row(i) trusts it to be non-decreasing and
+    // bounded by nnz (both ends are pinned, so that is all it takes)
+    const int64_t *ptr = indptr();
+    bool valid{ptr[0] == 0 && static_cast<uint64_t>(ptr[nrow_]) == nnz_};
+    for (uint64_t i{0}; valid && i < nrow_; ++i) {
+      valid = ptr[i] <= ptr[i + 1];
+    }
+    if (!valid) {
+      throw std::runtime_error(
+          std::format("ERROR(SparseMatrix): Broken indptr [{}]", path));
+    }
+  }
+
+  uint64_t nrow() const { return nrow_; }
+  uint64_t ncol() const { return ncol_; }
+  uint64_t nnz() const { return nnz_; }
+  const MappedFile &file() const { return file_; }
+
+  const int64_t *indptr() const { return file_.as<int64_t>(kCsrHeaderBytes); }
+  const int32_t *indices() const {
+    return file_.as<int32_t>(csrIndicesOffset(nrow_));
+  }
+  const float *values() const {
+    return file_.as<float>(csrValuesOffset(nrow_, nnz_));
+  }
+
+  SparseRow row(uint64_t i) const {
+    int64_t begin{indptr()[i]};
+    return {indices() + begin, values() + begin,
+            static_cast<uint64_t>(indptr()[i + 1] - begin)};
+  }
+
+ private:
+  MappedFile file_;
+  uint64_t nrow_{0};
+  uint64_t ncol_{0};
+  uint64_t nnz_{0};
+};
+
+// NOTE: Writes a CSR file whose row lengths are known up front. Header and
+// indptr go out on construction, rows can then be written from any thread in
+// any order since every row has a fixed offset.
+class SparseWriter {
+ public:
+  SparseWriter(const std::string &path, uint64_t ncol,
+               std::vector<int64_t> indptr)
+      : indptr_(std::move(indptr)) {
+    nrow_ = indptr_.size() - 1;
+    nnz_ = indptr_.back();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw std::runtime_error(
+          std::format("ERROR(SparseWriter): Failed Open File [{}]", path));
+    }
+    if (::ftruncate(fd_, csrFileBytes(nrow_, nnz_)) != 0) {
+      ::close(fd_);
+      throw std::runtime_error("ERROR(SparseWriter): Failed Resize File");
+    }
+    int64_t header[3]{static_cast<int64_t>(nrow_), static_cast<int64_t>(ncol),
+                      static_cast<int64_t>(nnz_)};
+    writeAt(fd_, header, sizeof(header), 0);
+    writeAt(fd_, indptr_.data(), indptr_.size() * sizeof(int64_t),
+            kCsrHeaderBytes);
+  }
+
+  SparseWriter(const SparseWriter &) = delete;
+  SparseWriter &operator=(const SparseWriter &) = delete;
+
+  ~SparseWriter() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  const std::vector<int64_t> &indptr() const { return indptr_; }
+
+  // NOTE: indices/values of the rows [firstRow, lastRow) packed back to back
+  void writeRows(uint64_t firstRow, uint64_t lastRow, const int32_t *indices,
+                 const float *values) const {
+    uint64_t begin = indptr_[firstRow];
+    uint64_t count = indptr_[lastRow] - begin;
+    writeAt(fd_, indices, count * sizeof(int32_t),
+            csrIndicesOffset(nrow_) + begin * sizeof(int32_t));
+    writeAt(fd_, values, count * sizeof(float),
+            csrValuesOffset(nrow_, nnz_) + begin * sizeof(float));
+  }
+
+ private:
+  std::vector<int64_t> indptr_;
+  uint64_t nrow_{0};
+  uint64_t nnz_{0};
+  int fd_{-1};
+};
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "parallel.hpp"
+#include "sparseFile.hpp"
+
+constexpr uint64_t kGrainRows = 1UL << 14;
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+struct SparseStats {
+  uint64_t minRowNnz{std::numeric_limits<uint64_t>::max()};
+  uint64_t maxRowNnz{0};
+  uint64_t emptyRows{0};
+  uint64_t badIndices{0};
+  uint64_t unsortedRows{0};
+  double valueSum{0};
+  float minValue{std::numeric_limits<float>::max()};
+  float maxValue{std::numeric_limits<float>::lowest()};
+  std::vector<uint64_t> columnDf{};
+
+  void merge(const SparseStats &other) {
+    minRowNnz = std::min(minRowNnz, other.minRowNnz);
+    maxRowNnz = std::max(maxRowNnz, other.maxRowNnz);
+    emptyRows += other.emptyRows;
+    badIndices += other.badIndices;
+    unsortedRows += other.unsortedRows;
+    valueSum += other.valueSum;
+    minValue = std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+    for (std::size_t j{0}; j < columnDf.size(); ++j) {
+      columnDf[j] += other.columnDf[j];
+    }
+  }
+};
+
+void printSparseStats(const std::string &path, unsigned threads) {
+  SparseMatrix matrix(path);
+  matrix.file().adviseSequential();
+  const uint64_t ncol{matrix.ncol()};
+
+  std::vector<SparseStats> local(threads);
+  for (auto &stats : local) {
+    stats.columnDf.assign(ncol, 0);
+  }
+  parallelFor(
+      0, matrix.nrow(), kGrainRows,
+      [&](uint64_t begin, uint64_t end, unsigned tid) {
+        SparseStats &stats = local[tid];
+        for (uint64_t i{begin}; i < end; ++i) {
+          SparseRow row{matrix.row(i)};
+          stats.minRowNnz = std::min(stats.minRowNnz, row.nnz);
+          stats.maxRowNnz = std::max(stats.maxRowNnz, row.nnz);
+          stats.emptyRows += row.nnz == 0;
+          for (uint64_t k{0}; k < row.nnz; ++k) {
+            int32_t j{row.indices[k]};
+            if (j < 0 || static_cast<uint64_t>(j) >= ncol) {
+              ++stats.badIndices;
+            } else {
+              ++stats.columnDf[j];
+            }
+            stats.valueSum += row.values[k];
+            stats.minValue = std::min(stats.minValue, row.values[k]);
+            stats.maxValue = std::max(stats.maxValue, row.values[k]);
+          }
+          if (!std::is_sorted(row.indices, row.indices + row.nnz)) {
+            ++stats.unsortedRows;
+          }
+        }
+      },
+      threads);
+
+  SparseStats total{local[0]};
+  for (unsigned t{1}; t < threads; ++t) {
+    total.merge(local[t]);
+  }
+  uint64_t usedColumns{0}, maxDf{0};
+  for (uint64_t df : total.columnDf) {
+    usedColumns += df != 0;
+    maxDf = std::max(maxDf, df);
+  }
+
+  const uint64_t nrow{matrix.nrow()}, nnz{matrix.nnz()};
+  std::cout << std::format("nrow: {}, ncol: {}, nnz: {}", nrow, ncol, nnz)
+            << std::endl;
+  std::cout << std::format("density: {:.6f}%",
+                           nrow * ncol == 0 ? 0.0
+                                            : 100.0 * nnz / (nrow * ncol))
+            << std::endl;
+  if (nrow > 0) {
+    std::cout << std::format("nnz per row: min {}, mean {:.2f}, max {}, "
+                             "empty rows {}",
+                             total.minRowNnz, static_cast<double>(nnz) / nrow,
+                             total.maxRowNnz, total.emptyRows)
+              << std::endl;
+  }
+  std::cout << std::format("columns used: {} of {}, max document frequency {}",
+                           usedColumns, ncol, maxDf)
+            << std::endl;
+  if (nnz > 0) {
+    std::cout << std::format("values: min {}, mean {:.6f}, max {}",
+                             total.minValue, total.valueSum / nnz,
+                             total.maxValue)
+              << std::endl;
+  }
+  if (total.badIndices > 0 || total.unsortedRows > 0) {
+    std::cout << std::format("WARNING: {} indices outside ncol, {} rows with "
+                             "unsorted indices",
+                             total.badIndices, total.unsortedRows)
+              << std::endl;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 3) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./sparse_stats [csr file path] [threads(optional)]"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string path{argv[1]};
+  unsigned threads{hardwareThreads()};
+  try {
+    checkFileExists(path);
+    checkSidecar(path);
+    if (argc == 3) {
+      threads = std::max(1, std::stoi(argv[2]));
+    }
+    printSparseStats(path, threads);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [threads] Argument must be an integer." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
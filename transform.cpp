@@ -1,14 +1,33 @@
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <ios>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
-#include <sys/types.h>
 #include <utility>
+#include <vector>
+
+#include "checksum.hpp"
+#include "fileIO.hpp"
+#include "formatTraits.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include "sparseFile.hpp"
+
+// NOTE: rows are converted and written in chunks of roughly this many bytes
+constexpr std::size_t kChunkBytes = 64UL << 20;
 
 void checkFileExists(const std::string &path) {
   if (!std::filesystem::exists(path)) {
@@ -16,10 +35,6 @@ void checkFileExists(const std::string &path) {
   }
 }
 
-bool checkFileSize(const std::string &path, unsigned expectLen) {
-  return std::filesystem::file_size(path) == expectLen;
-}
-
 std::fstream openBinaryFile(const std::string &path,
                             std::ios_base::openmode mode) {
   std::fstream reader(path, std::ios::binary | mode);
@@ -27,134 +42,314 @@ std::fstream openBinaryFile(const std::string &path,
     std::cout << std::format("ERROR: Failed Open File [{}]", path) << std::endl;
     throw std::runtime_error("Failed to open file");
   }
-  return std::move(reader);
+  return reader;
 }
 
-template <typename T>
-void loadMetaInfo(const std::string &path, unsigned &npts, unsigned &dims,
-                  bool isBin) {
-  std::fstream reader{openBinaryFile(path, std::ios::in)};
-  if (isBin) {
-    reader.read(reinterpret_cast<char *>(&npts), sizeof(unsigned));
+struct TransformJob {
+  std::string sourcePath;
+  std::string targetPath;
+  Container sourceContainer;
+  Container targetContainer;
+};
+
+void loadMetaInfo(const MappedFile &source, Container container,
+                  std::size_t elemBytes, uint64_t &npts, uint32_t &dims) {
+  if (source.size() < sizeof(uint32_t)) {
+    throw std::runtime_error("Source file too small: " + source.path());
+  }
+  uint64_t expectSize{0};
+  if (container == Container::Bin) {
+    if (source.size() < 2 * sizeof(uint32_t)) {
+      throw std::runtime_error("Source file too small: " + source.path());
+    }
+    uint32_t header[2];
+    std::memcpy(header, source.data(), sizeof(header));
+    npts = header[0];
+    dims = header[1];
+    expectSize = fileHeaderBytes(container) + npts * dims * elemBytes;
+  } else {
+    std::memcpy(&dims, source.data(), sizeof(uint32_t));
+    uint64_t rowBytes{rowPrefixBytes(container) + dims * elemBytes};
+    npts = source.size() / rowBytes;
+    expectSize = npts * rowBytes;
   }
-  reader.read(reinterpret_cast<char *>(&dims), sizeof(unsigned));
-  if (!isBin) {
-    npts = std::filesystem::file_size(path) /
-           (dims * sizeof(T) + sizeof(unsigned));
+  if (dims == 0) {
+    throw std::runtime_error("Source file has zero dims: " + source.path());
+  }
+  if (expectSize != source.size()) {
+    throw std::runtime_error(
+        std::format("File size mismatch: Expected {} bytes, but got {} bytes "
+                    "for file: {}",
+                    expectSize, source.size(), source.path()));
   }
 }
 
-unsigned getCutSize(unsigned expectSize, unsigned npts) {
-  if (expectSize > npts) {
-    std::cout << std::format("WARNING: Expected cut size: {} greater than npts "
-                             "{} of dataset, Using npts as cut size ",
-                             expectSize, npts)
-              << std::endl;
-    return npts;
-  } else {
-    return expectSize;
+// NOTE: Single streaming pass, source rows are read straight out of the
+// mapping and converted into the output chunk, no full-size buffer is built.
+template <typename S, typename D>
+void transformStream(const TransformJob &job) {
+  MappedFile source(job.sourcePath);
+  source.adviseSequential();
+
+  uint64_t npts{0};
+  uint32_t dims{0};
+  loadMetaInfo(source, job.sourceContainer, sizeof(S), npts, dims);
+  std::cout << std::format("Source Data Info: npts[{}], dims[{}]", npts, dims)
+            << std::endl;
+  if (job.targetContainer == Container::Bin &&
+      npts > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("npts does not fit into a bin header");
   }
-}
 
-unsigned readDims(const std::string &path, bool isBin = true) {
-  unsigned dims{0};
-  std::fstream reader = openBinaryFile(path, std::ios::in);
-  if (isBin) {
-    reader.seekg(sizeof(unsigned), std::ios::beg);
+  const std::size_t srcPrefix{rowPrefixBytes(job.sourceContainer)};
+  const std::size_t dstPrefix{rowPrefixBytes(job.targetContainer)};
+  const std::size_t srcRowBytes{srcPrefix + dims * sizeof(S)};
+  const std::size_t dstRowBytes{dstPrefix + dims * sizeof(D)};
+  const std::size_t chunkRows{
+      std::max<std::size_t>(1, kChunkBytes / dstRowBytes)};
+
+  std::fstream writer = openBinaryFile(job.targetPath, std::ios::out);
+  if (job.targetContainer == Container::Bin) {
+    uint32_t header[2]{static_cast<uint32_t>(npts), dims};
+    writer.write(reinterpret_cast<const char *>(header), sizeof(header));
   }
-  reader.read(reinterpret_cast<char *>(&dims), sizeof(unsigned));
-  return dims;
-}
 
-template <typename T> std::unique_ptr<T[]> readBin(const std::string &path) {
-  std::fstream reader = openBinaryFile(path, std::ios::in);
+  std::unique_ptr<char[]> chunk = std::make_unique<char[]>(
+      std::min<uint64_t>(chunkRows, npts) * dstRowBytes);
+  const char *src = source.data() + fileHeaderBytes(job.sourceContainer);
+  for (uint64_t begin{0}; begin < npts; begin += chunkRows) {
+    uint64_t rows{std::min<uint64_t>(chunkRows, npts - begin)};
+    for (uint64_t r{0}; r < rows; ++r) {
+      const char *srcRow = src + (begin + r) * srcRowBytes;
+      char *dstRow = chunk.get() + r * dstRowBytes;
+      if (dstPrefix != 0) {
+        std::memcpy(dstRow, &dims, sizeof(uint32_t));
+      }
+      convertRow<S, D>(reinterpret_cast<const S *>(srcRow + srcPrefix),
+                       reinterpret_cast<D *>(dstRow + dstPrefix), dims);
+    }
+    writer.write(chunk.get(), rows * dstRowBytes);
+  }
+  writer.flush();
+  writer.close();
+}
 
-  unsigned npts{0}, dims{0};
+using TransformFn = void (*)(const TransformJob &);
 
-  reader.read(reinterpret_cast<char *>(&npts), sizeof(unsigned));
-  reader.read(reinterpret_cast<char *>(&dims), sizeof(unsigned));
+template <std::size_t S, std::size_t... D>
+constexpr std::array<TransformFn, kNumElemTypes>
+makeTransformRow(std::index_sequence<D...>) {
+  return {&transformStream<ElemOf<static_cast<ElemType>(S)>,
+                           ElemOf<static_cast<ElemType>(D)>>...};
+}
 
-  std::unique_ptr<T[]> data = std::make_unique<T[]>(npts * dims);
-  reader.read(reinterpret_cast<char *>(data.get()), sizeof(T) * npts * dims);
-  reader.close();
-  return data;
+template <std::size_t... S>
+constexpr std::array<std::array<TransformFn, kNumElemTypes>, kNumElemTypes>
+makeTransformMatrix(std::index_sequence<S...>) {
+  return {makeTransformRow<S>(std::make_index_sequence<kNumElemTypes>{})...};
 }
 
-template <typename T> std::unique_ptr<T[]> readVec(const std::string &path) {
-  std::fstream reader = openBinaryFile(path, std::ios::in);
-  unsigned npts{0}, dims{0};
+// NOTE: kTransformMatrix[source type][target type]
+constexpr auto kTransformMatrix =
+    makeTransformMatrix(std::make_index_sequence<kNumElemTypes>{});
 
-  reader.read(reinterpret_cast<char *>(&dims), sizeof(unsigned));
-  // NOTE: compute npts using file_size
-  npts =
-      std::filesystem::file_size(path) / (sizeof(unsigned) + sizeof(T) * dims);
+// NOTE: Dense (any element type) -> csr in two streaming passes over the
+// mapping: count the non-zeros of every row to build indptr, then write the
+// rows in parallel at their final offsets. Values are stored as f32.
+template <typename T> void denseToSparse(const TransformJob &job) {
+  MappedFile source(job.sourcePath);
+  uint64_t npts{0};
+  uint32_t dims{0};
+  loadMetaInfo(source, job.sourceContainer, sizeof(T), npts, dims);
+  std::cout << std::format("Source Data Info: npts[{}], dims[{}]", npts, dims)
+            << std::endl;
 
-  unsigned bufSize{
-      static_cast<unsigned int>((sizeof(T) * dims + sizeof(unsigned)) * npts)};
+  const std::size_t srcPrefix{rowPrefixBytes(job.sourceContainer)};
+  const std::size_t srcRowBytes{srcPrefix + dims * sizeof(T)};
+  const char *src = source.data() + fileHeaderBytes(job.sourceContainer);
+  auto row = [&](uint64_t i) {
+    return reinterpret_cast<const T *>(src + i * srcRowBytes + srcPrefix);
+  };
+  const uint64_t grain{std::max<uint64_t>(1, kChunkBytes / srcRowBytes)};
 
-  reader.seekg(0, std::ios::beg);
-  std::unique_ptr<char[]> byteData = std::make_unique<char[]>(bufSize);
-  reader.read(reinterpret_cast<char *>(byteData.get()), bufSize);
+  std::vector<int64_t> indptr(npts + 1, 0);
+  parallelFor(0, npts, grain, [&](uint64_t begin, uint64_t end, unsigned) {
+    for (uint64_t i{begin}; i < end; ++i) {
+      const T *values = row(i);
+      int64_t count{0};
+      for (uint32_t j{0}; j < dims; ++j) {
+        count += toFloat(values[j]) != 0.0f;
+      }
+      indptr[i + 1] = count;
+    }
+  });
+  for (uint64_t i{0}; i < npts; ++i) {
+    indptr[i + 1] += indptr[i];
+  }
+  std::cout << std::format("Non-Zeros: {} ({:.4f}% dense)", indptr[npts],
+                           npts * dims == 0
+                               ? 0.0
+                               : 100.0 * indptr[npts] / (npts * dims))
+            << std::endl;
 
-  std::unique_ptr<T[]> data = std::make_unique<T[]>(npts * dims);
-  unsigned nodeSize{
-      static_cast<unsigned int>((sizeof(T) * dims + sizeof(unsigned)))};
+  SparseWriter writer(job.targetPath, dims, std::move(indptr));
+  parallelFor(0, npts, grain, [&](uint64_t begin, uint64_t end, unsigned) {
+    std::vector<int32_t> indices;
+    std::vector<float> values;
+    indices.reserve(writer.indptr()[end] - writer.indptr()[begin]);
+    values.reserve(indices.capacity());
+    for (uint64_t i{begin}; i < end; ++i) {
+      const T *dense = row(i);
+      for (uint32_t j{0}; j < dims; ++j) {
+        float value{toFloat(dense[j])};
+        if (value != 0.0f) {
+          indices.push_back(static_cast<int32_t>(j));
+          values.push_back(value);
+        }
+      }
+    }
+    writer.writeRows(begin, end, indices.data(), values.data());
+  });
+}
 
-  for (unsigned i{0}; i < npts; ++i) {
-    std::memcpy(data.get() + i * dims,
-                byteData.get() + i * nodeSize + sizeof(unsigned),
-                sizeof(T) * dims);
+// NOTE: csr -> dense, rows are scattered into zeroed chunks in parallel and
+// written at their final offsets
+template <typename T> void sparseToDense(const TransformJob &job) {
+  SparseMatrix source(job.sourcePath);
+  source.file().adviseSequential();
+  const uint64_t npts{source.nrow()};
+  const uint64_t dims{source.ncol()};
+  std::cout << std::format("Source Data Info: nrow[{}], ncol[{}], nnz[{}]",
+                           npts, dims, source.nnz())
+            << std::endl;
+  if (dims == 0 || dims > std::numeric_limits<uint32_t>::max() ||
+      (job.targetContainer == Container::Bin &&
+       npts > std::numeric_limits<uint32_t>::max())) {
+    throw std::runtime_error(
+        "csr shape (zero or too many cols) does not fit into a dense header");
   }
 
-  return data;
+  const std::size_t dstPrefix{rowPrefixBytes(job.targetContainer)};
+  const std::size_t dstHeader{fileHeaderBytes(job.targetContainer)};
+  const std::size_t dstRowBytes{dstPrefix + dims * sizeof(T)};
+  int fd = ::open(job.targetPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + job.targetPath);
+  }
+  try {
+    if (::ftruncate(fd, dstHeader + npts * dstRowBytes) != 0) {
+      throw std::runtime_error("Failed to resize file: " + job.targetPath);
+    }
+    if (job.targetContainer == Container::Bin) {
+      uint32_t header[2]{static_cast<uint32_t>(npts),
+                         static_cast<uint32_t>(dims)};
+      writeAt(fd, header, sizeof(header), 0);
+    }
+    const uint32_t dims32{static_cast<uint32_t>(dims)};
+    const uint64_t grain{std::max<uint64_t>(1, kChunkBytes / dstRowBytes)};
+    parallelFor(0, npts, grain, [&](uint64_t begin, uint64_t end, unsigned) {
+      std::unique_ptr<char[]> chunk =
+          std::make_unique<char[]>((end - begin) * dstRowBytes);
+      for (uint64_t i{begin}; i < end; ++i) {
+        char *dstRow = chunk.get() + (i - begin) * dstRowBytes;
+        if (dstPrefix != 0) {
+          std::memcpy(dstRow, &dims32, sizeof(uint32_t));
+        }
+        T *dense = reinterpret_cast<T *>(dstRow + dstPrefix);
+        SparseRow sparse{source.row(i)};
+        for (uint64_t k{0}; k < sparse.nnz; ++k) {
+          int32_t j{sparse.indices[k]};
+          if (j < 0 || static_cast<uint64_t>(j) >= dims) {
+            throw std::runtime_error(
+                std::format("Row {} has column {} outside ncol[{}]", i, j,
+                            dims));
+          }
+          dense[j] = fromFloat<T>(sparse.values[k]);
+        }
+      }
+      writeAt(fd, chunk.get(), (end - begin) * dstRowBytes,
+              dstHeader + begin * dstRowBytes);
+    });
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
 }
 
-template <typename T>
-void writeBin(const std::string &path, const std::unique_ptr<T[]> data,
-              const unsigned npts, const unsigned dims) {
-  std::fstream writer = openBinaryFile(path, std::ios::out);
-  writer.write(reinterpret_cast<const char *>(&npts), sizeof(unsigned));
-  writer.write(reinterpret_cast<const char *>(&dims), sizeof(unsigned));
-  writer.write(reinterpret_cast<const char *>(data.get()),
-               sizeof(T) * npts * dims);
-  writer.flush();
-  writer.close();
+template <std::size_t... E>
+constexpr std::array<TransformFn, kNumElemTypes>
+makeDenseToSparse(std::index_sequence<E...>) {
+  return {&denseToSparse<ElemOf<static_cast<ElemType>(E)>>...};
 }
 
-template <typename T>
-void writeVec(const std::string &path, const std::unique_ptr<T[]> data,
-              const unsigned npts, const unsigned dims) {
-  std::fstream writer = openBinaryFile(path, std::ios::out);
-  unsigned bufSize = sizeof(T) * dims;
-  for (unsigned i{0}; i < npts; ++i) {
-    writer.write(reinterpret_cast<const char *>(&dims), sizeof(unsigned));
-    writer.write(reinterpret_cast<char *>(data.get() + i * dims), bufSize);
-  }
-  writer.flush();
-  writer.close();
+template <std::size_t... E>
+constexpr std::array<TransformFn, kNumElemTypes>
+makeSparseToDense(std::index_sequence<E...>) {
+  return {&sparseToDense<ElemOf<static_cast<ElemType>(E)>>...};
 }
 
-template <typename T>
-void transform(const std::string &sourcePath, const std::string &targetPath,
-               bool isBin) {
-  unsigned npts{0}, dims{0};
-  loadMetaInfo<T>(sourcePath, npts, dims, isBin);
-  std::cout << std::format("Source Data Info: npts[{}], dims[{}]", npts, dims)
+// NOTE: indexed by the element type of the dense side
+constexpr auto kDenseToSparse =
+    makeDenseToSparse(std::make_index_sequence<kNumElemTypes>{});
+constexpr auto kSparseToDense =
+    makeSparseToDense(std::make_index_sequence<kNumElemTypes>{});
+
+int transformSparse(const std::string &sourcePath,
+                    const std::string &sourceFormat,
+                    const std::string &targetPath,
+                    const std::string &targetFormat,
+                    const std::string &dataType) {
+  bool toSparse{targetFormat == "csr"};
+  const std::string &denseFormat{toSparse ? sourceFormat : targetFormat};
+  std::optional<Format> dense{parseFormat(denseFormat)};
+  if (!dense || sourceFormat == targetFormat) {
+    std::cerr << "ERROR: csr converts only to or from [bin] or [vecs] based "
+                 "formats"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::optional<ElemType> elem{dense->elem};
+  if (!elem) {
+    elem = dataType.empty() ? ElemType::F32 : parseElemType(dataType);
+  }
+  if (!elem) {
+    std::cerr << "ERROR: Input DataType does not meet requirements"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << std::format("Transform {} format to {} format ({} dense)",
+                           sourceFormat, targetFormat, elemName(*elem))
             << std::endl;
-  if (isBin) {
-    writeVec<T>(targetPath, readBin<T>(sourcePath), npts, dims);
-  } else {
-    writeBin<T>(targetPath, readVec<T>(sourcePath), npts, dims);
+
+  try {
+    StagedTarget staged(targetPath, {sourcePath});
+    TransformJob job{sourcePath, staged.path(), dense->container,
+                     dense->container};
+    const auto &table = toSparse ? kDenseToSparse : kSparseToDense;
+    table[static_cast<std::size_t>(*elem)](job);
+    staged.commit();
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
   }
+  std::cout << "Transform Done!" << std::endl;
+  return EXIT_SUCCESS;
 }
 
 int main(int argc, char **argv) {
-  if (argc != 6) {
+  if (argc != 5 && argc != 6) {
     std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
     std::cout
         << "Usage: ./transform [source dataset path] [source dataset format] "
            "[target dataset path] [target dataset format] [data type]"
         << std::endl;
+    std::cout << "  format:    bin, vecs or typed e.g. fbin, u8bin, i8bin, "
+                 "f16bin, bf16bin, fvecs, ivecs, bvecs, or csr (sparse)"
+              << std::endl;
+    std::cout << "  data type: u8, i8, u32, i32, f16, bf16, f32 (float, uint "
+                 "also accepted), only needed for untyped formats"
+              << std::endl;
 
     exit(EXIT_FAILURE);
   }
@@ -163,46 +358,75 @@ int main(int argc, char **argv) {
   std::string sourceFormat{argv[2]};
   std::string targetPath{argv[3]};
   std::string targetFormat{argv[4]};
-  std::string dataType{argv[5]};
+  std::string dataType{argc == 6 ? argv[5] : ""};
 
   try {
     sourcePath = argv[1];
     checkFileExists(sourcePath);
+    checkSidecar(sourcePath);
   } catch (const std::runtime_error &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     exit(EXIT_FAILURE);
   }
 
-  if (sourceFormat == targetFormat) {
-    std::cout << std::format(
-                     "Transform {} format to {} format? What Wrong With U???",
-                     sourceFormat, targetFormat)
-              << std::endl;
-  } else {
-    std::cout << std::format("Transform {} format to {} format", sourceFormat,
-                             targetFormat)
+  if (sourceFormat == "csr" || targetFormat == "csr") {
+    return transformSparse(sourcePath, sourceFormat, targetPath, targetFormat,
+                           dataType);
+  }
+
+  std::optional<Format> source{parseFormat(sourceFormat)};
+  std::optional<Format> target{parseFormat(targetFormat)};
+  if (!source || !target) {
+    std::cerr << "ERROR: Input format does not meet requirements, Please Using "
+                 "[bin] or [vecs] based format ~"
               << std::endl;
+    exit(EXIT_FAILURE);
   }
 
-  bool isBin{sourceFormat == std::string("bin") ? true : false};
+  std::optional<ElemType> dataElem{};
+  if (!dataType.empty()) {
+    dataElem = parseElemType(dataType);
+    if (!dataElem) {
+      std::cerr
+          << "ERROR: Input DataType does not meet requirements, Please Using "
+             "[u8] [i8] [u32] [i32] [f16] [bf16] or [f32] ~"
+          << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
 
-  if (sourceFormat != std::string("vecs") &&
-      sourceFormat != std::string("bin")) {
-    std::cerr << "ERROR: Input format does not meet requirements, Please Using "
-                 "[bin] or [vecs] format ~"
+  // NOTE: a typed format wins over [data type], an untyped target keeps the
+  // source element type
+  std::optional<ElemType> sourceElem{source->elem ? source->elem : dataElem};
+  if (!sourceElem) {
+    std::cerr << std::format("ERROR: Format [{}] needs a [data type] argument",
+                             sourceFormat)
               << std::endl;
     exit(EXIT_FAILURE);
   }
+  ElemType targetElem{target->elem ? *target->elem : *sourceElem};
 
-  if (dataType == std::string("float")) {
-    transform<float>(sourcePath, targetPath, isBin);
-  } else if (dataType == std::string("uint")) {
-    transform<uint>(sourcePath, targetPath, isBin);
+  if (source->container == target->container && *sourceElem == targetElem) {
+    std::cout << std::format(
+                     "Transform {} format to {} format? What Wrong With U???",
+                     sourceFormat, targetFormat)
+              << std::endl;
   } else {
-    std::cerr
-        << "ERROR: Input DataType does not meet requirements, Please Using "
-           "[float] or [uint] format ~"
-        << std::endl;
+    std::cout << std::format("Transform {} format ({}) to {} format ({})",
+                             sourceFormat, elemName(*sourceElem), targetFormat,
+                             elemName(targetElem))
+              << std::endl;
+  }
+
+  try {
+    StagedTarget staged(targetPath, {sourcePath});
+    TransformJob job{sourcePath, staged.path(), source->container,
+                     target->container};
+    kTransformMatrix[static_cast<std::size_t>(*sourceElem)]
+                    [static_cast<std::size_t>(targetElem)](job);
+    staged.commit();
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
     exit(EXIT_FAILURE);
   }
   std::cout << "Transform Done!" << std::endl;
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checksum.hpp"
+#include "formatTraits.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+
+// NOTE: leaf size of the tree hash
+constexpr uint64_t kChunkBytes = 64UL << 20;
+
+enum class VerifyMode { Quick, Write, Check };
+
+struct DatasetInfo {
+  std::string format{};
+  std::string elem{};
+  uint64_t npts{0};
+  uint64_t dims{0};
+  // NOTE: 0 for bin, bytes per row (prefix included) for vecs
+  uint64_t vecsRowBytes{0};
+};
+
+void checkFileExists(const std::string &path) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("ERROR(checkFileExists): File Not Found: " + path);
+  }
+}
+
+// NOTE: Validate the header against the file size. An untyped bin infers the
+// element size from the size, an untyped vecs is read as f32 like the other
+// tools do.
+DatasetInfo validateLayout(const MappedFile &file, const Format &format,
+                           const std::string &formatName) {
+  DatasetInfo info{formatName};
+  const uint64_t size{file.size()};
+  if (size < fileHeaderBytes(format.container) + sizeof(uint32_t)) {
+    throw std::runtime_error(
+        std::format("ERROR(verify): [{}] is too small ({} bytes)", file.path(),
+                    size));
+  }
+
+  if (format.container == Container::Bin) {
+    info.npts = file.as<uint32_t>()[0];
+    info.dims = file.as<uint32_t>()[1];
+    uint64_t payload{size - fileHeaderBytes(format.container)};
+    uint64_t elems{info.npts * info.dims};
+    if (format.elem) {
+      info.elem = elemName(*format.elem);
+      if (payload != elems * elemSize(*format.elem)) {
+        throw std::runtime_error(std::format(
+            "ERROR(verify): Header npts[{}] dims[{}] {} expects {} bytes, file "
+            "has {} bytes",
+            info.npts, info.dims, info.elem,
+            elems * elemSize(*format.elem) + 8, size));
+      }
+    } else if (elems == 0 ? payload != 0 : payload % elems != 0) {
+      throw std::runtime_error(std::format(
+          "ERROR(verify): Header npts[{}] dims[{}] does not divide the {} "
+          "payload bytes",
+          info.npts, info.dims, payload));
+    } else {
+      info.elem = std::format("{}byte", elems == 0 ? 0 : payload / elems);
+    }
+    return info;
+  }
+
+  ElemType elem{format.elem ? *format.elem : ElemType::F32};
+  info.elem = elemName(elem);
+  info.dims = file.as<uint32_t>()[0];
+  info.vecsRowBytes = rowPrefixBytes(format.container) +
+                      info.dims * elemSize(elem);
+  if (size % info.vecsRowBytes != 0) {
+    throw std::runtime_error(std::format(
+        "ERROR(verify): {} bytes is not a multiple of the {} byte row "
+        "(dims[{}], {}), file is truncated",
+        size, info.vecsRowBytes, info.dims, info.elem));
+  }
+  info.npts = size / info.vecsRowBytes;
+  return info;
+}
+
+// NOTE: One parallel pass over the mapping, hashing every chunk and, for vecs,
+// checking that each row repeats the same dims prefix.
+std::vector<uint64_t> hashChunks(const MappedFile &file,
+                                 const DatasetInfo &info, uint64_t chunkBytes,
+                                 unsigned threads) {
+  const uint64_t size{file.size()};
+  const uint64_t numChunks{(size + chunkBytes - 1) / chunkBytes};
+  std::vector<uint64_t> leaves(numChunks);
+  std::atomic<uint64_t> badRow{UINT64_MAX};
+
+  parallelFor(
+      0, numChunks, 1,
+      [&](uint64_t begin, uint64_t end, unsigned) {
+        for (uint64_t c{begin}; c < end; ++c) {
+          uint64_t lo{c * chunkBytes};
+          uint64_t hi{std::min(size, lo + chunkBytes)};
+          leaves[c] = xxh64(file.data() + lo, hi - lo);
+          if (info.vecsRowBytes == 0) {
+            continue;
+          }
+          uint64_t rb{info.vecsRowBytes};
+          for (uint64_t r{(lo + rb - 1) / rb}; r * rb < hi; ++r) {
+            uint32_t dims;
+            std::memcpy(&dims, file.data() + r * rb, sizeof(uint32_t));
+            if (dims != info.dims) {
+              uint64_t prev{badRow.load()};
+              while (r < prev && !badRow.compare_exchange_weak(prev, r)) {
+              }
+              break;
+            }
+          }
+        }
+      },
+      threads);
+
+  if (badRow != UINT64_MAX) {
+    throw std::runtime_error(std::format(
+        "ERROR(verify): Row {} has a dims prefix different from dims[{}]",
+        badRow.load(), info.dims));
+  }
+  return leaves;
+}
+
+bool verify(const std::string &path, const Format &format,
+            const std::string &formatName, VerifyMode mode, unsigned threads) {
+  MappedFile file(path);
+  DatasetInfo info{validateLayout(file, format, formatName)};
+  std::cout << std::format("Layout OK: npts[{}], dims[{}], elem[{}], {} bytes",
+                           info.npts, info.dims, info.elem, file.size())
+            << std::endl;
+
+  if (mode == VerifyMode::Quick) {
+    checkSidecar(path);
+    return true;
+  }
+
+  std::optional<Sidecar> stored{};
+  uint64_t chunkBytes{kChunkBytes};
+  if (mode == VerifyMode::Check) {
+    stored = readSidecar(path);
+    if (!stored) {
+      throw std::runtime_error(std::format(
+          "ERROR(verify): No sidecar [{}], run with --write first",
+          sidecarPath(path)));
+    }
+    chunkBytes = stored->chunkBytes;
+  }
+
+  file.adviseSequential();
+  std::vector<uint64_t> leaves{hashChunks(file, info, chunkBytes, threads)};
+  uint64_t root{treeRoot(leaves, file.size())};
+  std::cout << std::format("Tree Hash: {:016x} ({} chunks of {} bytes)", root,
+                           leaves.size(), chunkBytes)
+            << std::endl;
+
+  if (mode == VerifyMode::Write) {
+    writeSidecar(path, Sidecar{info.format, info.elem, file.size(),
+                               fileMtime(path), info.npts, info.dims,
+                               chunkBytes, root, leaves});
+    std::cout << std::format("Write Sidecar Into {}", sidecarPath(path))
+              << std::endl;
+    return true;
+  }
+
+  if (stored->size != file.size()) {
+    std::cerr << std::format("ERROR: Size {} differs from verified size {}",
+                             file.size(), stored->size)
+              << std::endl;
+    return false;
+  }
+  if (root == stored->root) {
+    return true;
+  }
+  for (std::size_t c{0}; c < leaves.size(); ++c) {
+    if (c >= stored->leaves.size() || leaves[c] != stored->leaves[c]) {
+      std::cerr << std::format("ERROR: Chunk {} (bytes [{}, {})) differs", c,
+                               c * chunkBytes,
+                               std::min<uint64_t>(file.size(),
+                                                  (c + 1) * chunkBytes))
+                << std::endl;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3 || argc > 7) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./verify [dataset path] [dataset format] "
+                 "[--quick|--write|--check] [data type(optional)] "
+                 "[--threads N]"
+              << std::endl;
+    std::cout << "  --quick: header/size check + sidecar size/mtime check"
+              << std::endl;
+    std::cout << "  --write: full scan, write <path>.vtsum" << std::endl;
+    std::cout << "  --check: full scan, compare against <path>.vtsum "
+                 "(default when the sidecar exists, else --write)"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::string path{argv[1]};
+  std::string formatName{argv[2]};
+  std::optional<VerifyMode> mode{};
+  std::string dataType{};
+  unsigned threads{hardwareThreads()};
+
+  try {
+    checkFileExists(path);
+    for (int i{3}; i < argc; ++i) {
+      std::string arg{argv[i]};
+      if (arg == "--quick") {
+        mode = VerifyMode::Quick;
+      } else if (arg == "--write") {
+        mode = VerifyMode::Write;
+      } else if (arg == "--check") {
+        mode = VerifyMode::Check;
+      } else if (arg == "--threads" && i + 1 < argc) {
+        threads = std::stoul(argv[++i]);
+      } else {
+        dataType = arg;
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << "Error: [--threads] Argument must be an integer." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::optional<Format> format{parseFormat(formatName)};
+  if (format && !dataType.empty()) {
+    format->elem = parseElemType(dataType);
+  }
+  if (!format || (!dataType.empty() && !format->elem)) {
+    std::cerr << "ERROR: Input format or data type does not meet requirements"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (!mode) {
+    mode = std::filesystem::exists(sidecarPath(path)) ? VerifyMode::Check
+                                                      : VerifyMode::Write;
+  }
+
+  try {
+    if (!verify(path, *format, formatName, *mode, threads)) {
+      std::cerr << std::format("Verify FAILED: [{}]", path) << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << std::format("Verify FAILED: [{}]", path) << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Verify Done!" << std::endl;
+}
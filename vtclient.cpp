@@ -0,0 +1,99 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "daemonProtocol.hpp"
+
+// NOTE: the daemon has its own working directory, so path arguments are
+// made absolute here: register [name] [path] ..., slice ... [target path]
+void absolutizePaths(std::vector<std::string> &args) {
+  if (args.size() >= 3 && args[0] == "register") {
+    args[2] = std::filesystem::absolute(args[2]).string();
+  } else if (args.size() == 5 && args[0] == "slice") {
+    args[4] = std::filesystem::absolute(args[4]).string();
+  }
+}
+
+std::string roundTrip(const std::string &socketPath,
+                      const std::vector<std::string> &args) {
+  sockaddr_un addr{makeSocketAddress(socketPath)};
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr),
+                          sizeof(addr)) != 0) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::runtime_error(std::format(
+        "ERROR(roundTrip): No daemon listening on [{}], start ./vtdaemon "
+        "first",
+        socketPath));
+  }
+  std::string response{};
+  try {
+    sendAll(fd, encodeRequest(args));
+    char chunk[64 << 10];
+    while (true) {
+      ssize_t got = ::recv(fd, chunk, sizeof(chunk), 0);
+      if (got < 0 && errno == EINTR) {
+        continue;
+      }
+      if (got < 0) {
+        throw std::runtime_error("ERROR(roundTrip): Failed Read Socket");
+      }
+      if (got == 0) {
+        break;
+      }
+      response.append(chunk, got);
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  return response;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./vtclient [socket path] [command] [args...]\n"
+                 "  ping\n"
+                 "  register [name] [path] [format] [data type(optional)]\n"
+                 "    format: fbin, u8bin, ..., bvecs, ..., csr, gt, layout\n"
+                 "  unregister [name]\n"
+                 "  list\n"
+                 "  info [name]\n"
+                 "  stats [name]\n"
+                 "  rows [name] [row spec, e.g. 0-9,15]\n"
+                 "  slice [name] [begin] [end] [target path]\n"
+                 "  recall [gt name] [result name] [k list(optional)]\n"
+                 "  shutdown"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::string> args(argv + 2, argv + argc);
+  std::string response{};
+  try {
+    absolutizePaths(args);
+    response = roundTrip(argv[1], args);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (response.starts_with("OK\n")) {
+    std::cout << response.substr(3);
+    return EXIT_SUCCESS;
+  }
+  std::cerr << (response.empty() ? "ERROR: Empty Response\n" : response);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,839 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "checksum.hpp"
+#include "daemonProtocol.hpp"
+#include "denseFile.hpp"
+#include "fileIO.hpp"
+#include "formatTraits.hpp"
+#include "layoutFile.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include "parseList.hpp"
+#include "recall.hpp"
+#include "sparseFile.hpp"
+
+// NOTE: rows a single `rows` request may print, bulk copies go through
+// `slice` which writes straight from the mapping to the target file
+constexpr uint64_t kMaxGatherRows = 1UL << 16;
+// NOTE: a client that stays silent (or stops reading) this long is dropped
+constexpr time_t kConnTimeoutSec = 30;
+// NOTE: rows converted per step while computing dense statistics
+constexpr uint64_t kStatsTileRows = 256;
+
+enum class DatasetKind { Dense, Result, Sparse, Layout };
+
+// NOTE: A registered dataset: the file stays mapped for the daemon's
+// lifetime (or until unregister), metadata is read once on register and
+// statistics are computed on first request and then cached. Requests hold
+// a shared_ptr, so unregistering never unmaps data still in use.
+struct Dataset {
+  std::string name{};
+  std::string path{};
+  std::string formatName{};
+  DatasetKind kind{DatasetKind::Dense};
+  uint64_t size{0};
+  int64_t mtime{0};
+
+  DenseFile dense{};
+  std::unique_ptr<MappedFile> denseMap{};
+  std::unique_ptr<ResultView> result{};
+  std::unique_ptr<SparseMatrix> sparse{};
+  std::unique_ptr<LayoutReader> layout{};
+
+  std::once_flag statsOnce{};
+  std::string stats{};
+
+  uint64_t rows() const {
+    switch (kind) {
+      case DatasetKind::Dense:
+        return dense.npts;
+      case DatasetKind::Result:
+        return result->npts;
+      case DatasetKind::Sparse:
+        return sparse->nrow();
+      case DatasetKind::Layout:
+        return layout->npts();
+    }
+    return 0;
+  }
+
+  const char *denseRow(uint64_t i) const {
+    return denseMap->data() + dense.headerBytes + i * dense.rowBytes +
+           rowPrefixBytes(dense.container);
+  }
+
+  // NOTE: only dense files take a data type, and formats like u8bin fix it
+  // regardless of the one requested, so compare the resolved element type
+  bool sameElemType(const std::string &dataType) const {
+    if (kind != DatasetKind::Dense) {
+      return true;
+    }
+    std::optional<Format> format{parseFormat(formatName)};
+    std::optional<ElemType> elem{parseElemType(dataType)};
+    return format && elem && format->elem.value_or(*elem) == dense.elem;
+  }
+
+  // NOTE: the mapping is a snapshot of the file at register time, refuse to
+  // serve it once the file on disk was replaced or rewritten
+  void checkFresh() const {
+    if (!std::filesystem::exists(path) ||
+        std::filesystem::file_size(path) != size || fileMtime(path) != mtime) {
+      throw std::runtime_error(std::format(
+          "[{}] changed on disk since it was registered as [{}], register it "
+          "again",
+          path, name));
+    }
+  }
+};
+
+std::shared_ptr<Dataset> openDataset(const std::string &name,
+                                     const std::string &path,
+                                     const std::string &formatName,
+                                     const std::string &dataType) {
+  if (!std::filesystem::exists(path)) {
+    throw std::runtime_error("File Not Found: " + path);
+  }
+  checkSidecar(path);
+  auto dataset = std::make_shared<Dataset>();
+  dataset->name = name;
+  dataset->path = path;
+  dataset->formatName = formatName;
+  dataset->size = std::filesystem::file_size(path);
+  dataset->mtime = fileMtime(path);
+
+  if (formatName == "gt" || formatName == "result") {
+    dataset->kind = DatasetKind::Result;
+    dataset->result = std::make_unique<ResultView>(mapResultBin(path));
+  } else if (formatName == "csr") {
+    dataset->kind = DatasetKind::Sparse;
+    dataset->sparse = std::make_unique<SparseMatrix>(path);
+  } else if (formatName == "layout") {
+    dataset->kind = DatasetKind::Layout;
+    dataset->layout = std::make_unique<LayoutReader>(path);
+  } else {
+    std::optional<Format> format{parseFormat(formatName)};
+    std::optional<ElemType> elem{parseElemType(dataType)};
+    if (!format || !elem) {
+      throw std::runtime_error(std::format(
+          "Unknown format [{}] or data type [{}]", formatName, dataType));
+    }
+    dataset->kind = DatasetKind::Dense;
+    dataset->dense =
+        inspectDenseFile(path, *format, format->elem.value_or(*elem));
+    dataset->denseMap = std::make_unique<MappedFile>(path);
+  }
+  return dataset;
+}
+
+std::string describe(const Dataset &dataset) {
+  std::string kind{};
+  std::string shape{};
+  switch (dataset.kind) {
+    case DatasetKind::Dense:
+      kind = std::format("dense {} {}", dataset.formatName,
+                         elemName(dataset.dense.elem));
+      shape = std::format("npts {}\ndims {}\n", dataset.dense.npts,
+                          dataset.dense.dims);
+      break;
+    case DatasetKind::Result:
+      kind = dataset.result->dists ? "result ids+dists" : "result ids";
+      shape = std::format("npts {}\nk {}\n", dataset.result->npts,
+                          dataset.result->dims);
+      break;
+    case DatasetKind::Sparse:
+      kind = "csr";
+      shape = std::format("npts {}\ncols {}\nnnz {}\n", dataset.sparse->nrow(),
+                          dataset.sparse->ncol(), dataset.sparse->nnz());
+      break;
+    case DatasetKind::Layout: {
+      const LayoutReader &layout = *dataset.layout;
+      kind = std::format("layout {} {}", layoutName(layout.kind()),
+                         elemName(layout.elem()));
+      shape = std::format("npts {}\ndims {}\nblock_rows {}\n", layout.npts(),
+                          layout.dims(), layout.blockRows());
+      break;
+    }
+  }
+  return std::format("name {}\npath {}\nkind {}\n{}size {}\n", dataset.name,
+                     dataset.path, kind, shape, dataset.size);
+}
+
+class Registry {
+ public:
+  // NOTE: registering the same unchanged file under the same name and type
+  // again is a no-op, so scripts can register unconditionally before every
+  // run
+  std::shared_ptr<Dataset> add(const std::string &name, const std::string &path,
+                               const std::string &formatName,
+                               const std::string &dataType) {
+    {
+      std::shared_lock lock(mutex_);
+      auto it = datasets_.find(name);
+      if (it != datasets_.end() && it->second->path == path &&
+          it->second->formatName == formatName &&
+          it->second->sameElemType(dataType)) {
+        try {
+          it->second->checkFresh();
+          return it->second;
+        } catch (const std::runtime_error &) {
+        }
+      }
+    }
+    std::shared_ptr<Dataset> dataset{
+        openDataset(name, path, formatName, dataType)};
+    std::unique_lock lock(mutex_);
+    datasets_[name] = dataset;
+    return dataset;
+  }
+
+  bool remove(const std::string &name) {
+    std::unique_lock lock(mutex_);
+    return datasets_.erase(name) > 0;
+  }
+
+  std::shared_ptr<Dataset> find(const std::string &name) const {
+    std::shared_lock lock(mutex_);
+    auto it = datasets_.find(name);
+    if (it == datasets_.end()) {
+      throw std::runtime_error(
+          std::format("Dataset [{}] is not registered", name));
+    }
+    it->second->checkFresh();
+    return it->second;
+  }
+
+  std::vector<std::shared_ptr<Dataset>> all() const {
+    std::shared_lock lock(mutex_);
+    std::vector<std::shared_ptr<Dataset>> list{};
+    for (const auto &[name, dataset] : datasets_) {
+      list.push_back(dataset);
+    }
+    return list;
+  }
+
+ private:
+  mutable std::shared_mutex mutex_;
+  std::map<std::string, std::shared_ptr<Dataset>> datasets_;
+};
+
+struct DenseStats {
+  double min{std::numeric_limits<double>::infinity()};
+  double max{-std::numeric_limits<double>::infinity()};
+  double sum{0};
+  double normSum{0};
+  uint64_t nonFinite{0};
+};
+
+// NOTE: loadTile(begin, end, dst) converts rows [begin, end) to dense f32
+template <typename F>
+std::string computeValueStats(uint64_t npts, uint32_t dims, F &&loadTile,
+                              unsigned threads) {
+  std::vector<DenseStats> partial(threads);
+  parallelFor(
+      0, npts, kStatsTileRows,
+      [&](uint64_t begin, uint64_t end, unsigned tid) {
+        DenseStats &stats = partial[tid];
+        std::vector<float> rows((end - begin) * dims);
+        loadTile(begin, end, rows.data());
+        for (uint64_t i{0}; i < end - begin; ++i) {
+          double norm{0};
+          for (uint32_t j{0}; j < dims; ++j) {
+            float v{rows[i * dims + j]};
+            if (!std::isfinite(v)) {
+              ++stats.nonFinite;
+              continue;
+            }
+            stats.min = std::min<double>(stats.min, v);
+            stats.max = std::max<double>(stats.max, v);
+            stats.sum += v;
+            norm += double{v} * v;
+          }
+          stats.normSum += std::sqrt(norm);
+        }
+      },
+      threads);
+  DenseStats total{};
+  for (const DenseStats &stats : partial) {
+    total.min = std::min(total.min, stats.min);
+    total.max = std::max(total.max, stats.max);
+    total.sum += stats.sum;
+    total.normSum += stats.normSum;
+    total.nonFinite += stats.nonFinite;
+  }
+  double values = static_cast<double>(npts) * dims;
+  return std::format("min {}\nmax {}\nmean {}\nmean_norm {}\nnon_finite {}\n",
+                     total.min, total.max,
+                     total.sum / std::max(1.0, values - total.nonFinite),
+                     total.normSum / std::max<uint64_t>(1, npts),
+                     total.nonFinite);
+}
+
+using LayoutToFloatFn = void (*)(const LayoutReader &reader, uint64_t begin,
+                                 uint64_t end, float *dst);
+
+template <typename T>
+void layoutRowsToFloat(const LayoutReader &reader, uint64_t begin,
+                       uint64_t end, float *dst) {
+  std::vector<T> row(reader.dims());
+  for (uint64_t i{begin}; i < end; ++i) {
+    reader.gatherRow<T>(i, row.data());
+    convertRow<T, float>(row.data(), dst + (i - begin) * reader.dims(),
+                         reader.dims());
+  }
+}
+
+template <std::size_t... E>
+constexpr std::array<LayoutToFloatFn, kNumElemTypes>
+makeLayoutToFloat(std::index_sequence<E...>) {
+  return {&layoutRowsToFloat<ElemOf<static_cast<ElemType>(E)>>...};
+}
+
+constexpr auto kLayoutToFloat =
+    makeLayoutToFloat(std::make_index_sequence<kNumElemTypes>{});
+
+std::string computeDenseStats(const Dataset &dataset, unsigned threads) {
+  const DenseFile &file = dataset.dense;
+  return computeValueStats(
+      file.npts, file.dims,
+      [&](uint64_t begin, uint64_t end, float *dst) {
+        kToFloat[static_cast<std::size_t>(file.elem)](
+            dataset.denseRow(begin), end - begin, file.dims, file.rowBytes,
+            dst);
+      },
+      threads);
+}
+
+std::string computeLayoutStats(const LayoutReader &layout, unsigned threads) {
+  return computeValueStats(
+      layout.npts(), layout.dims(),
+      [&](uint64_t begin, uint64_t end, float *dst) {
+        kLayoutToFloat[static_cast<std::size_t>(layout.elem())](layout, begin,
+                                                                 end, dst);
+      },
+      threads);
+}
+
+std::string computeSparseStats(const SparseMatrix &matrix) {
+  const int64_t *indptr = matrix.indptr();
+  uint64_t minNnz{std::numeric_limits<uint64_t>::max()};
+  uint64_t maxNnz{0};
+  uint64_t emptyRows{0};
+  for (uint64_t i{0}; i < matrix.nrow(); ++i) {
+    uint64_t nnz = indptr[i + 1] - indptr[i];
+    minNnz = std::min(minNnz, nnz);
+    maxNnz = std::max(maxNnz, nnz);
+    emptyRows += nnz == 0;
+  }
+  int32_t maxIndex{-1};
+  float minValue{std::numeric_limits<float>::infinity()};
+  float maxValue{-std::numeric_limits<float>::infinity()};
+  for (uint64_t i{0}; i < matrix.nnz(); ++i) {
+    maxIndex = std::max(maxIndex, matrix.indices()[i]);
+    minValue = std::min(minValue, matrix.values()[i]);
+    maxValue = std::max(maxValue, matrix.values()[i]);
+  }
+  return std::format(
+      "nnz_per_row_min {}\nnnz_per_row_max {}\nnnz_per_row_mean {}\n"
+      "empty_rows {}\nmax_index {}\nvalue_min {}\nvalue_max {}\n",
+      matrix.nrow() ? minNnz : 0, maxNnz,
+      static_cast<double>(matrix.nnz()) /
+          std::max<uint64_t>(1, matrix.nrow()),
+      emptyRows, maxIndex, minValue, maxValue);
+}
+
+std::string computeResultStats(const ResultView &view) {
+  uint64_t count{uint64_t{view.npts} * view.dims};
+  uint32_t maxId{0};
+  for (uint64_t i{0}; i < count; ++i) {
+    maxId = std::max(maxId, view.ids[i]);
+  }
+  std::string stats{std::format("max_id {}\n", count ? maxId : 0)};
+  if (view.dists != nullptr && count > 0) {
+    auto [lo, hi] = std::minmax_element(view.dists, view.dists + count);
+    stats += std::format("dist_min {}\ndist_max {}\n", *lo, *hi);
+  }
+  return stats;
+}
+
+const std::string &cachedStats(Dataset &dataset, unsigned threads) {
+  std::call_once(dataset.statsOnce, [&] {
+    switch (dataset.kind) {
+      case DatasetKind::Dense:
+        dataset.stats = computeDenseStats(dataset, threads);
+        break;
+      case DatasetKind::Result:
+        dataset.stats = computeResultStats(*dataset.result);
+        break;
+      case DatasetKind::Sparse:
+        dataset.stats = computeSparseStats(*dataset.sparse);
+        break;
+      case DatasetKind::Layout:
+        dataset.stats = computeLayoutStats(*dataset.layout, threads);
+        break;
+    }
+  });
+  return dataset.stats;
+}
+
+using AppendRowFn = void (*)(std::string &out, const char *row,
+                             uint32_t dims);
+
+template <typename T>
+void appendDenseRow(std::string &out, const char *row, uint32_t dims) {
+  const T *values = reinterpret_cast<const T *>(row);
+  for (uint32_t j{0}; j < dims; ++j) {
+    if constexpr (ElemTraits<T>::isFloat) {
+      out += std::format(" {}", toFloat(values[j]));
+    } else {
+      out += std::format(" {}", static_cast<int64_t>(values[j]));
+    }
+  }
+}
+
+template <std::size_t... E>
+constexpr std::array<AppendRowFn, kNumElemTypes>
+makeAppendRow(std::index_sequence<E...>) {
+  return {&appendDenseRow<ElemOf<static_cast<ElemType>(E)>>...};
+}
+
+constexpr auto kAppendRow =
+    makeAppendRow(std::make_index_sequence<kNumElemTypes>{});
+
+using AppendLayoutRowFn = void (*)(std::string &out,
+                                   const LayoutReader &reader, uint64_t i);
+
+template <typename T>
+void appendLayoutRow(std::string &out, const LayoutReader &reader,
+                     uint64_t i) {
+  std::vector<T> row(reader.dims());
+  reader.gatherRow<T>(i, row.data());
+  appendDenseRow<T>(out, reinterpret_cast<const char *>(row.data()),
+                    reader.dims());
+}
+
+template <std::size_t... E>
+constexpr std::array<AppendLayoutRowFn, kNumElemTypes>
+makeAppendLayoutRow(std::index_sequence<E...>) {
+  return {&appendLayoutRow<ElemOf<static_cast<ElemType>(E)>>...};
+}
+
+constexpr auto kAppendLayoutRow =
+    makeAppendLayoutRow(std::make_index_sequence<kNumElemTypes>{});
+
+// NOTE: "0-9,15" style row list, same syntax as ./layout --dims
+std::vector<uint64_t> parseRowSpec(const std::string &spec, uint64_t rows) {
+  std::vector<uint64_t> ids{};
+  for (const IdRange &range : parseRangeList(spec)) {
+    if (range.last >= rows) {
+      throw std::runtime_error(
+          std::format("Row spec [{}-{}] out of range for npts[{}]",
+                      range.first, range.last, rows));
+    }
+    if (ids.size() + (range.last - range.first + 1) > kMaxGatherRows) {
+      throw std::runtime_error(std::format(
+          "At most {} rows per request, use slice for bulk copies",
+          kMaxGatherRows));
+    }
+    for (uint64_t i{range.first}; i <= range.last; ++i) {
+      ids.push_back(i);
+    }
+  }
+  return ids;
+}
+
+std::string gatherRows(const Dataset &dataset, const std::string &spec) {
+  std::string out{};
+  for (uint64_t i : parseRowSpec(spec, dataset.rows())) {
+    out += std::format("{}:", i);
+    switch (dataset.kind) {
+      case DatasetKind::Dense:
+        kAppendRow[static_cast<std::size_t>(dataset.dense.elem)](
+            out, dataset.denseRow(i), dataset.dense.dims);
+        break;
+      case DatasetKind::Result: {
+        const ResultView &view = *dataset.result;
+        for (uint32_t j{0}; j < view.dims; ++j) {
+          out += std::format(" {}", view.ids[i * view.dims + j]);
+        }
+        if (view.dists != nullptr) {
+          out += " |";
+          for (uint32_t j{0}; j < view.dims; ++j) {
+            out += std::format(" {}", view.dists[i * view.dims + j]);
+          }
+        }
+        break;
+      }
+      case DatasetKind::Sparse: {
+        SparseRow row{dataset.sparse->row(i)};
+        for (uint64_t j{0}; j < row.nnz; ++j) {
+          out += std::format(" {}:{}", row.indices[j], row.values[j]);
+        }
+        break;
+      }
+      case DatasetKind::Layout:
+        kAppendLayoutRow[static_cast<std::size_t>(dataset.layout->elem())](
+            out, *dataset.layout, i);
+        break;
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+// NOTE: Rows [begin, end) into a new file of the same format, copied
+// straight out of the mapping.
+std::string sliceToFile(const Dataset &dataset, uint64_t begin, uint64_t end,
+                        const std::string &target) {
+  if (dataset.kind == DatasetKind::Layout) {
+    throw std::runtime_error(
+        "slice works on source formats, slice the source and re-run ./layout");
+  }
+  if (begin > end || end > dataset.rows()) {
+    throw std::runtime_error(std::format(
+        "Slice [{}, {}) out of range for npts[{}]", begin, end,
+        dataset.rows()));
+  }
+  const uint64_t count{end - begin};
+  if (dataset.kind == DatasetKind::Sparse) {
+    const SparseMatrix &matrix = *dataset.sparse;
+    std::vector<int64_t> indptr(matrix.indptr() + begin,
+                                matrix.indptr() + end + 1);
+    const int64_t first{indptr.front()};
+    for (int64_t &offset : indptr) {
+      offset -= first;
+    }
+    SparseWriter writer(target, matrix.ncol(), std::move(indptr));
+    writer.writeRows(0, count, matrix.indices() + first,
+                     matrix.values() + first);
+    return std::format("rows {}\nnnz {}\n", count, writer.indptr().back());
+  }
+
+  int fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed Open Target File " + target);
+  }
+  uint64_t bytes{0};
+  try {
+    if (dataset.kind == DatasetKind::Dense) {
+      const DenseFile &file = dataset.dense;
+      if (file.container == Container::Bin) {
+        uint32_t header[2]{static_cast<uint32_t>(count), file.dims};
+        writeAt(fd, header, sizeof(header), 0);
+      }
+      const char *rows = dataset.denseMap->data() + file.headerBytes +
+                         begin * file.rowBytes;
+      writeAt(fd, rows, count * file.rowBytes, file.headerBytes);
+      bytes = file.headerBytes + count * file.rowBytes;
+    } else {
+      const ResultView &view = *dataset.result;
+      uint32_t header[2]{static_cast<uint32_t>(count), view.dims};
+      uint64_t idsBytes{count * view.dims * sizeof(uint32_t)};
+      writeAt(fd, header, sizeof(header), 0);
+      writeAt(fd, view.ids + begin * view.dims, idsBytes, sizeof(header));
+      bytes = sizeof(header) + idsBytes;
+      if (view.dists != nullptr) {
+        writeAt(fd, view.dists + begin * view.dims, idsBytes, bytes);
+        bytes += idsBytes;
+      }
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  return std::format("rows {}\nbytes {}\n", count, bytes);
+}
+
+// NOTE: same tie handling as ./compute_recall_std, queries are scored in
+// parallel straight from the two mappings
+std::string recallAgainstGT(const Dataset &gt, const Dataset &res,
+                            const std::vector<uint32_t> &ks,
+                            unsigned threads) {
+  if (gt.kind != DatasetKind::Result || res.kind != DatasetKind::Result) {
+    throw std::runtime_error("recall needs two datasets registered as gt");
+  }
+  const ResultView &g = *gt.result;
+  const ResultView &r = *res.result;
+  if (g.npts != r.npts) {
+    throw std::runtime_error(
+        std::format("{} queries, GT has {}", r.npts, g.npts));
+  }
+  std::string out{};
+  std::vector<double> recallList(g.npts);
+  for (uint32_t k : ks) {
+    if (k == 0 || k > g.dims || k > r.dims) {
+      out += std::format("recall@{} skipped, GT K {}, result K {}\n", k,
+                         g.dims, r.dims);
+      continue;
+    }
+    parallelFor(
+        0, g.npts, 256,
+        [&](uint64_t begin, uint64_t end, unsigned) {
+          for (uint64_t q{begin}; q < end; ++q) {
+            recallList[q] = calculateSingleRecall(
+                g.ids + q * g.dims,
+                g.dists == nullptr ? nullptr : g.dists + q * g.dims, g.dims,
+                r.ids + q * r.dims, r.dims, k);
+          }
+        },
+        threads);
+    out += std::format("recall@{} mean {} std {}\n", k,
+                       computeRecallAvg(recallList),
+                       computeRecallSTD(recallList));
+  }
+  return out;
+}
+
+class Server {
+ public:
+  Server(std::string socketPath, unsigned threads)
+      : socketPath_(std::move(socketPath)), threads_(threads) {}
+
+  void run() {
+    sockaddr_un addr{makeSocketAddress(socketPath_)};
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+      throw std::runtime_error("ERROR(Server): Failed Create Socket");
+    }
+    removeStaleSocket(addr);
+    if (::bind(listenFd_, reinterpret_cast<sockaddr *>(&addr),
+               sizeof(addr)) != 0 ||
+        ::listen(listenFd_, SOMAXCONN) != 0) {
+      throw std::runtime_error(std::format(
+          "ERROR(Server): Failed Bind Socket [{}]: {}", socketPath_,
+          std::strerror(errno)));
+    }
+    std::cout << std::format("Listening On {}", socketPath_) << std::endl;
+
+    while (!stopping_) {
+      int conn = ::accept(listenFd_, nullptr, nullptr);
+      if (conn < 0) {
+        if (stopping_ || errno != EINTR) {
+          break;
+        }
+        continue;
+      }
+      timeval timeout{kConnTimeoutSec, 0};
+      ::setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      ::setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      {
+        std::lock_guard<std::mutex> lock(activeMutex_);
+        ++active_;
+      }
+      std::thread([this, conn] { serve(conn); }).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(activeMutex_);
+    activeDone_.wait(lock, [this] { return active_ == 0; });
+    ::close(listenFd_);
+    std::filesystem::remove(socketPath_);
+  }
+
+ private:
+  // NOTE: a socket file left behind by a killed daemon is removed, one that
+  // still accepts connections belongs to a running daemon
+  void removeStaleSocket(const sockaddr_un &addr) {
+    if (!std::filesystem::exists(socketPath_)) {
+      return;
+    }
+    int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    bool alive{::connect(probe, reinterpret_cast<const sockaddr *>(&addr),
+                         sizeof(addr)) == 0};
+    ::close(probe);
+    if (alive) {
+      throw std::runtime_error(std::format(
+          "ERROR(Server): A daemon is already listening on [{}]",
+          socketPath_));
+    }
+    std::filesystem::remove(socketPath_);
+  }
+
+  // NOTE: connections still waiting for their request are tracked, so a
+  // shutdown can cut them off instead of waiting out their timeout
+  std::vector<std::string> readTrackedRequest(int conn) {
+    {
+      std::lock_guard<std::mutex> lock(activeMutex_);
+      readingConns_.insert(conn);
+      if (stopping_) {
+        ::shutdown(conn, SHUT_RD);
+      }
+    }
+    std::vector<std::string> args{};
+    try {
+      args = readRequest(conn);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(activeMutex_);
+      readingConns_.erase(conn);
+      throw;
+    }
+    std::lock_guard<std::mutex> lock(activeMutex_);
+    readingConns_.erase(conn);
+    return args;
+  }
+
+  void serve(int conn) {
+    std::string response{};
+    try {
+      response = "OK\n" + handle(readTrackedRequest(conn));
+    } catch (const std::exception &e) {
+      response = std::format("ERROR: {}\n", e.what());
+    }
+    try {
+      sendAll(conn, response);
+    } catch (const std::runtime_error &) {
+      // NOTE: client went away, nothing left to report to
+    }
+    ::close(conn);
+    std::lock_guard<std::mutex> lock(activeMutex_);
+    if (--active_ == 0) {
+      activeDone_.notify_all();
+    }
+  }
+
+  static void expectArgs(const std::vector<std::string> &args,
+                         std::size_t min, std::size_t max,
+                         const std::string &usage) {
+    if (args.size() < min || args.size() > max) {
+      throw std::runtime_error("Usage: " + usage);
+    }
+  }
+
+  std::string handle(const std::vector<std::string> &args) {
+    if (args.empty()) {
+      throw std::runtime_error("Empty Request");
+    }
+    const std::string &command = args[0];
+    if (command == "ping") {
+      return "pong\n";
+    } else if (command == "register") {
+      expectArgs(args, 4, 5, "register [name] [path] [format] [data type]");
+      return describe(*registry_.add(args[1], args[2], args[3],
+                                     args.size() == 5 ? args[4] : "f32"));
+    } else if (command == "unregister") {
+      expectArgs(args, 2, 2, "unregister [name]");
+      if (!registry_.remove(args[1])) {
+        throw std::runtime_error(
+            std::format("Dataset [{}] is not registered", args[1]));
+      }
+      return "";
+    } else if (command == "list") {
+      std::string out{};
+      for (const auto &dataset : registry_.all()) {
+        out += std::format("{} {} {} {}\n", dataset->name,
+                           dataset->formatName, dataset->rows(),
+                           dataset->path);
+      }
+      return out;
+    } else if (command == "info") {
+      expectArgs(args, 2, 2, "info [name]");
+      return describe(*registry_.find(args[1]));
+    } else if (command == "stats") {
+      expectArgs(args, 2, 2, "stats [name]");
+      return cachedStats(*registry_.find(args[1]), threads_);
+    } else if (command == "rows") {
+      expectArgs(args, 3, 3, "rows [name] [row spec, e.g. 0-9,15]");
+      return gatherRows(*registry_.find(args[1]), args[2]);
+    } else if (command == "slice") {
+      expectArgs(args, 5, 5, "slice [name] [begin] [end] [target path]");
+      // NOTE: registered files are mapped, truncating one for the target
+      // would corrupt it under every reader
+      for (const auto &dataset : registry_.all()) {
+        if (sameFile(dataset->path, args[4])) {
+          throw std::runtime_error(std::format(
+              "Target [{}] is registered as [{}], slice into another path",
+              args[4], dataset->name));
+        }
+      }
+      return sliceToFile(*registry_.find(args[1]), std::stoull(args[2]),
+                         std::stoull(args[3]), args[4]);
+    } else if (command == "recall") {
+      expectArgs(args, 3, 4, "recall [gt name] [result name] [k list]");
+      std::string ks{args.size() == 4 ? args[3] : "1,10,100"};
+      return recallAgainstGT(*registry_.find(args[1]),
+                             *registry_.find(args[2]), parseKList(ks),
+                             threads_);
+    } else if (command == "shutdown") {
+      std::lock_guard<std::mutex> lock(activeMutex_);
+      stopping_ = true;
+      ::shutdown(listenFd_, SHUT_RDWR);
+      for (int conn : readingConns_) {
+        ::shutdown(conn, SHUT_RD);
+      }
+      return "";
+    }
+    throw std::runtime_error("Unknown Command: " + command);
+  }
+
+  std::string socketPath_;
+  unsigned threads_;
+  int listenFd_{-1};
+  std::atomic<bool> stopping_{false};
+  Registry registry_{};
+  std::mutex activeMutex_{};
+  std::condition_variable activeDone_{};
+  uint64_t active_{0};
+  std::set<int> readingConns_{};
+};
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 4) {
+    std::cerr << "ERROR: Argument Mismatch, Please Follow Usage" << std::endl;
+    std::cout << "Usage: ./vtdaemon [socket path] [--threads N]" << std::endl;
+    std::cout << "       Talk to it with ./vtclient [socket path] [command] "
+                 "[args...], commands: ping, register, unregister, list, "
+                 "info, stats, rows, slice, recall, shutdown"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned threads{hardwareThreads()};
+  if (argc == 4) {
+    if (std::string(argv[2]) != "--threads") {
+      std::cerr << "Error Usage, Unknown Option: " << argv[2] << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    try {
+      threads = std::max(1, std::stoi(argv[3]));
+    } catch (const std::exception &e) {
+      std::cerr << "Error: --threads must be an integer." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  try {
+    Server server(argv[1], threads);
+    server.run();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Daemon Stopped!" << std::endl;
+}